@@ -0,0 +1,761 @@
+/* symtablebtree.c */
+/* Author: Vikram Kakaria */
+
+/* Nodes are allocated with posix_memalign. */
+#define _POSIX_C_SOURCE 200112L
+
+#include "symtablebtree.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+/* The minimum degree of the B-tree. Every node other than the root
+holds between MIN_DEGREE - 1 and MAX_KEYS keys, and an inner node has
+one more child than it has keys. */
+#define MIN_DEGREE 4
+#define MAX_KEYS (2 * MIN_DEGREE - 1)
+
+/* Number of leading bytes of a key kept in its node as an integer. */
+#define KEY_PREFIX_SIZE 8
+
+/* Size of a cache line on most machines, to which nodes are aligned. */
+#define CACHE_LINE_SIZE 64
+
+/* A node of the B-tree. The first bytes of each key are packed into
+an integer, big end first, so that comparing two prefixes as integers
+orders them as strcmp would. The prefixes, the key count and the leaf
+flag take up the first 64 bytes, and nodes are aligned to
+CACHE_LINE_SIZE, so they fill one cache line on most machines: a
+search within a node reads that line and follows a key pointer only
+when a prefix matches exactly. Leaves are allocated without the
+children array. */
+struct Node {
+    /* Leading bytes of each key, padded with null bytes */
+    uint64_t prefixes[MAX_KEYS];
+
+    /* Number of keys in the node */
+    unsigned int count;
+
+    /* 1 if the node is a leaf, 0 if it has children */
+    unsigned int isLeaf;
+
+    /* Keys, in increasing order */
+    const char *keys[MAX_KEYS];
+
+    /* Value of each key */
+    const void *values[MAX_KEYS];
+
+    /* Subtrees: children[i] holds the keys that are less than keys[i]
+    and greater than keys[i-1] */
+    struct Node *children[];
+};
+
+/* A SymTable (indicating a symbol table) is a B-tree of bindings, so
+its bindings can be visited in order of key. */
+struct SymTable {
+    /* The root node, which is never NULL. */
+    struct Node *root;
+
+    /* Tells number of bindings present. */
+    size_t length;
+};
+
+/* Return the first KEY_PREFIX_SIZE bytes of pcKey packed into an
+integer, big end first, padded with null bytes if pcKey is shorter. */
+static uint64_t Key_prefix(const char *pcKey){
+    uint64_t uPrefix = 0;
+    size_t u;
+
+    for(u=0; u<KEY_PREFIX_SIZE; u++){
+        uPrefix <<= 8;
+        if(*pcKey!='\0'){
+            uPrefix |= (unsigned char)*pcKey;
+            pcKey++;
+        }
+    }
+    return uPrefix;
+}
+
+/* Compare pcKey, whose prefix is uPrefix, with pcOther, whose prefix
+is uOtherPrefix, as strcmp would. */
+static int Key_compare(const char *pcKey, uint64_t uPrefix,
+     const char *pcOther, uint64_t uOtherPrefix){
+    if(uPrefix!=uOtherPrefix){
+        return uPrefix < uOtherPrefix ? -1 : 1;
+    }
+
+    /* Equal prefixes ending in a null byte mean equal keys, since a
+    key ends at its first null character. */
+    if((uPrefix & 0xFF)==0){
+        return 0;
+    }
+    return strcmp(pcKey + KEY_PREFIX_SIZE, pcOther + KEY_PREFIX_SIZE);
+}
+
+/* Return a new node without keys, which is a leaf if iIsLeaf, or NULL
+if not enough memory is available. The node starts on a cache line. */
+static struct Node *Node_new(int iIsLeaf){
+    void *pvNode;
+    struct Node *node;
+    size_t size = offsetof(struct Node, children);
+
+    if(!iIsLeaf){
+        size += (MAX_KEYS + 1) * sizeof(struct Node*);
+    }
+    if(posix_memalign(&pvNode, CACHE_LINE_SIZE, size)!=0){
+        return NULL;
+    }
+    node = (struct Node*)pvNode;
+    node->count = 0;
+    node->isLeaf = (unsigned int)iIsLeaf;
+    return node;
+}
+
+/* Free poNode, its subtrees and all of their keys. */
+static void Node_free(struct Node *poNode){
+    unsigned int i;
+
+    for(i=0; i<poNode->count; i++){
+        free((char*)poNode->keys[i]);
+    }
+    if(!poNode->isLeaf){
+        for(i=0; i<=poNode->count; i++){
+            Node_free(poNode->children[i]);
+        }
+    }
+    free(poNode);
+}
+
+/* Return the index of the first key in poNode that is not less than
+pcKey, whose prefix is uPrefix, or poNode->count if there is none. Set
+*piFound to 1 if that key is pcKey, or to 0 otherwise. */
+static unsigned int Node_search(const struct Node *poNode,
+     const char *pcKey, uint64_t uPrefix, int *piFound){
+    unsigned int i;
+    int iCompare;
+
+    for(i=0; i<poNode->count; i++){
+        iCompare = Key_compare(poNode->keys[i], poNode->prefixes[i],
+            pcKey, uPrefix);
+        if(iCompare>=0){
+            *piFound = (iCompare==0);
+            return i;
+        }
+    }
+    *piFound = 0;
+    return poNode->count;
+}
+
+/* Move the keys of poNode from index uFirst on, with their values and
+the children to their right, iBy places along (left if iBy is
+negative). The node's count is not changed. */
+static void Node_shift(struct Node *poNode, unsigned int uFirst,
+     int iBy){
+    unsigned int uMoved = poNode->count - uFirst;
+    unsigned int uTo = (unsigned int)((int)uFirst + iBy);
+
+    memmove(&poNode->prefixes[uTo], &poNode->prefixes[uFirst],
+        uMoved * sizeof(poNode->prefixes[0]));
+    memmove(&poNode->keys[uTo], &poNode->keys[uFirst],
+        uMoved * sizeof(poNode->keys[0]));
+    memmove(&poNode->values[uTo], &poNode->values[uFirst],
+        uMoved * sizeof(poNode->values[0]));
+    if(!poNode->isLeaf){
+        memmove(&poNode->children[uTo + 1],
+            &poNode->children[uFirst + 1],
+            uMoved * sizeof(poNode->children[0]));
+    }
+}
+
+/* Copy key uFrom of poFrom, with its value, to index uTo of poTo. */
+static void Node_copyKey(struct Node *poTo, unsigned int uTo,
+     const struct Node *poFrom, unsigned int uFrom){
+    poTo->prefixes[uTo] = poFrom->prefixes[uFrom];
+    poTo->keys[uTo] = poFrom->keys[uFrom];
+    poTo->values[uTo] = poFrom->values[uFrom];
+}
+
+/* Split children[uIndex] of poParent, which must be full while
+poParent is not, in two around its middle key, which moves up into
+poParent. Return 1 (for true) on success, or 0 (for false) if not
+enough memory is available, in which case nothing changes. */
+static int Node_split(struct Node *poParent, unsigned int uIndex){
+    struct Node *left = poParent->children[uIndex];
+    struct Node *right;
+    unsigned int i;
+
+    assert(left->count==MAX_KEYS);
+    assert(poParent->count<MAX_KEYS);
+
+    right = Node_new((int)left->isLeaf);
+    if(right==NULL){
+        return 0;
+    }
+
+    /* The upper MIN_DEGREE - 1 keys, and the children around them,
+    go to the new node. */
+    for(i=0; i<MIN_DEGREE-1; i++){
+        Node_copyKey(right, i, left, i + MIN_DEGREE);
+    }
+    if(!left->isLeaf){
+        for(i=0; i<MIN_DEGREE; i++){
+            right->children[i] = left->children[i + MIN_DEGREE];
+        }
+    }
+    right->count = MIN_DEGREE - 1;
+    left->count = MIN_DEGREE - 1;
+
+    /* The middle key goes up, with the new node to its right. */
+    Node_shift(poParent, uIndex, 1);
+    Node_copyKey(poParent, uIndex, left, MIN_DEGREE - 1);
+    poParent->children[uIndex + 1] = right;
+    poParent->count += 1;
+    return 1;
+}
+
+/* Merge children[uIndex + 1] of poParent, and the key between them,
+into children[uIndex]. Both children must have MIN_DEGREE - 1 keys. */
+static void Node_merge(struct Node *poParent, unsigned int uIndex){
+    struct Node *left = poParent->children[uIndex];
+    struct Node *right = poParent->children[uIndex + 1];
+    unsigned int i;
+
+    Node_copyKey(left, left->count, poParent, uIndex);
+    for(i=0; i<right->count; i++){
+        Node_copyKey(left, left->count + 1 + i, right, i);
+    }
+    if(!left->isLeaf){
+        for(i=0; i<=right->count; i++){
+            left->children[left->count + 1 + i] = right->children[i];
+        }
+    }
+    left->count += 1 + right->count;
+    free(right);
+
+    Node_shift(poParent, uIndex + 1, -1);
+    poParent->count -= 1;
+}
+
+/* Make sure children[uIndex] of poParent has at least MIN_DEGREE keys,
+taking one from a sibling through poParent or merging it with a
+sibling, so that a key can be removed below it without it running
+short. Return the index of the child that now covers the keys that
+children[uIndex] covered. */
+static unsigned int Node_fill(struct Node *poParent,
+     unsigned int uIndex){
+    struct Node *child = poParent->children[uIndex];
+    struct Node *sibling;
+    struct Node *first;
+
+    /* Take the last key of the left sibling. */
+    if(uIndex>0
+        && poParent->children[uIndex - 1]->count>=MIN_DEGREE){
+        sibling = poParent->children[uIndex - 1];
+        first = child->isLeaf ? NULL : child->children[0];
+        Node_shift(child, 0, 1);
+        if(!child->isLeaf){
+            /* Node_shift moved only the children right of each key. */
+            child->children[1] = first;
+            child->children[0] = sibling->children[sibling->count];
+        }
+        Node_copyKey(child, 0, poParent, uIndex - 1);
+        Node_copyKey(poParent, uIndex - 1, sibling, sibling->count - 1);
+        child->count += 1;
+        sibling->count -= 1;
+        return uIndex;
+    }
+
+    /* Take the first key of the right sibling. */
+    if(uIndex<poParent->count
+        && poParent->children[uIndex + 1]->count>=MIN_DEGREE){
+        sibling = poParent->children[uIndex + 1];
+        Node_copyKey(child, child->count, poParent, uIndex);
+        if(!child->isLeaf){
+            child->children[child->count + 1] = sibling->children[0];
+            sibling->children[0] = sibling->children[1];
+        }
+        Node_copyKey(poParent, uIndex, sibling, 0);
+        Node_shift(sibling, 1, -1);
+        child->count += 1;
+        sibling->count -= 1;
+        return uIndex;
+    }
+
+    /* Neither sibling can spare a key, so merge with one. */
+    if(uIndex<poParent->count){
+        Node_merge(poParent, uIndex);
+        return uIndex;
+    }
+    Node_merge(poParent, uIndex - 1);
+    return uIndex - 1;
+}
+
+/* Remove the binding whose key is pcKey, whose prefix is uPrefix, from
+the subtree poNode, which must have at least MIN_DEGREE keys unless it
+is the root. Set *ppcKey and *ppvValue to the key and value of the
+binding and return 1 (for true), or return 0 (for false) if there is
+no such binding. The key is not freed. */
+static int Node_remove(struct Node *poNode, const char *pcKey,
+     uint64_t uPrefix, const char **ppcKey, const void **ppvValue){
+    struct Node *child;
+    struct Node *neighbour;
+    const char *pcNeighbourKey;
+    const void *pvNeighbourValue;
+    uint64_t uNeighbourPrefix;
+    unsigned int i;
+    int iFound;
+
+    for(;;){
+        i = Node_search(poNode, pcKey, uPrefix, &iFound);
+
+        if(iFound && poNode->isLeaf){
+            *ppcKey = poNode->keys[i];
+            *ppvValue = poNode->values[i];
+            Node_shift(poNode, i + 1, -1);
+            poNode->count -= 1;
+            return 1;
+        }
+
+        if(iFound){
+            /* Replace the key by its predecessor or successor from a
+            child that can spare a key, and remove that one from the
+            child instead. */
+            child = poNode->children[i];
+            neighbour = poNode->children[i + 1];
+            if(child->count>=MIN_DEGREE){
+                while(!child->isLeaf){
+                    child = child->children[child->count];
+                }
+                neighbour = child;
+                child = poNode->children[i];
+                pcNeighbourKey = neighbour->keys[neighbour->count - 1];
+                pvNeighbourValue =
+                    neighbour->values[neighbour->count - 1];
+                uNeighbourPrefix =
+                    neighbour->prefixes[neighbour->count - 1];
+            }
+            else if(neighbour->count>=MIN_DEGREE){
+                child = neighbour;
+                while(!neighbour->isLeaf){
+                    neighbour = neighbour->children[0];
+                }
+                pcNeighbourKey = neighbour->keys[0];
+                pvNeighbourValue = neighbour->values[0];
+                uNeighbourPrefix = neighbour->prefixes[0];
+            }
+            else{
+                /* Neither child can spare a key: pull the key down
+                into their merger and remove it from there. */
+                Node_merge(poNode, i);
+                poNode = poNode->children[i];
+                continue;
+            }
+
+            *ppcKey = poNode->keys[i];
+            *ppvValue = poNode->values[i];
+            (void)Node_remove(child, pcNeighbourKey, uNeighbourPrefix,
+                &pcNeighbourKey, &pvNeighbourValue);
+            poNode->keys[i] = pcNeighbourKey;
+            poNode->values[i] = pvNeighbourValue;
+            poNode->prefixes[i] = uNeighbourPrefix;
+            return 1;
+        }
+
+        if(poNode->isLeaf){
+            return 0;
+        }
+
+        if(poNode->children[i]->count<MIN_DEGREE){
+            i = Node_fill(poNode, i);
+        }
+        poNode = poNode->children[i];
+    }
+}
+
+/* Apply pfApply to every binding of the subtree poNode, in order,
+passing pvExtra as an extra parameter. */
+static void Node_map(struct Node *poNode,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     void *pvExtra){
+    unsigned int i;
+
+    for(i=0; i<poNode->count; i++){
+        if(!poNode->isLeaf){
+            Node_map(poNode->children[i], pfApply, pvExtra);
+        }
+        (*pfApply)(poNode->keys[i], (void*)poNode->values[i], pvExtra);
+    }
+    if(!poNode->isLeaf){
+        Node_map(poNode->children[poNode->count], pfApply, pvExtra);
+    }
+}
+
+/* The bindings an ordered traversal visits: those whose keys are not
+less than low and, while they last, are less than high and start with
+prefix. Any of the three may be NULL, leaving the range open. */
+struct Bounds {
+    /* Smallest key visited, or NULL */
+    const char *low;
+
+    /* Prefix of low */
+    uint64_t lowPrefix;
+
+    /* Key at which the traversal stops, or NULL */
+    const char *high;
+
+    /* Prefix of high */
+    uint64_t highPrefix;
+
+    /* Start shared by every key visited, or NULL */
+    const char *prefix;
+
+    /* Length of prefix */
+    size_t prefixLength;
+
+    /* Function applied to each binding visited */
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+
+    /* Extra parameter of pfApply */
+    void *extra;
+};
+
+/* Return 1 (for true) if the key of binding uIndex of poNode, and so
+every key after it, is past the end of poBounds, or 0 (for false)
+otherwise. */
+static int Bounds_isPast(const struct Bounds *poBounds,
+     const struct Node *poNode, unsigned int uIndex){
+    if(poBounds->high!=NULL
+        && Key_compare(poNode->keys[uIndex], poNode->prefixes[uIndex],
+        poBounds->high, poBounds->highPrefix)>=0){
+        return 1;
+    }
+    if(poBounds->prefix!=NULL
+        && strncmp(poNode->keys[uIndex], poBounds->prefix,
+        poBounds->prefixLength)!=0){
+        return 1;
+    }
+    return 0;
+}
+
+/* Apply poBounds->pfApply to every binding of the subtree poNode that
+lies within poBounds, in order. Subtrees wholly below the range are
+skipped. Return 1 (for true) once a key past the end of the range has
+been met, so that the caller stops too, or 0 (for false) otherwise. */
+static int Node_mapBounded(struct Node *poNode,
+     const struct Bounds *poBounds){
+    unsigned int i;
+    int iCompare;
+
+    for(i=0; i<poNode->count; i++){
+        iCompare = 1;
+        if(poBounds->low!=NULL){
+            iCompare = Key_compare(poNode->keys[i],
+                poNode->prefixes[i], poBounds->low,
+                poBounds->lowPrefix);
+        }
+
+        /* This key, and everything to its left, is below the range. */
+        if(iCompare<0){
+            continue;
+        }
+        if(iCompare>0 && !poNode->isLeaf){
+            if(Node_mapBounded(poNode->children[i], poBounds)){
+                return 1;
+            }
+        }
+        if(Bounds_isPast(poBounds, poNode, i)){
+            return 1;
+        }
+        (*poBounds->pfApply)(poNode->keys[i], (void*)poNode->values[i],
+            poBounds->extra);
+    }
+    if(!poNode->isLeaf){
+        return Node_mapBounded(poNode->children[poNode->count],
+            poBounds);
+    }
+    return 0;
+}
+
+SymTable_T SymTable_new(void){
+    SymTable_T oSymTable;
+
+    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+
+    /* Not enough memory */
+    if(oSymTable==NULL){
+        return NULL;
+    }
+
+    oSymTable->root = Node_new(1);
+    if(oSymTable->root==NULL){
+        free(oSymTable);
+        return NULL;
+    }
+    oSymTable->length = 0;
+    return oSymTable;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+
+    Node_free(oSymTable->root);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+    return oSymTable->length;
+}
+
+/* Return the node of oSymTable holding pcKey, and set *puIndex to its
+index there, or return NULL if there is no such key. */
+static struct Node *SymTable_find(SymTable_T oSymTable,
+     const char *pcKey, unsigned int *puIndex){
+    struct Node *node = oSymTable->root;
+    uint64_t uPrefix = Key_prefix(pcKey);
+    unsigned int i;
+    int iFound;
+
+    for(;;){
+        i = Node_search(node, pcKey, uPrefix, &iFound);
+        if(iFound){
+            *puIndex = i;
+            return node;
+        }
+        if(node->isLeaf){
+            return NULL;
+        }
+        node = node->children[i];
+    }
+}
+
+int SymTable_put(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    struct Node *node;
+    struct Node *newRoot;
+    uint64_t uPrefix;
+    unsigned int i;
+    int iFound;
+    char *keyCopy;
+    size_t keySize;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    if(SymTable_find(oSymTable, pcKey, &i)!=NULL){
+        return 0;
+    }
+
+    keySize = strlen(pcKey)+1;
+    keyCopy = (char*)malloc(keySize);
+    if(keyCopy==NULL){
+        return 0;
+    }
+    memcpy(keyCopy, pcKey, keySize);
+    uPrefix = Key_prefix(pcKey);
+
+    /* A full root is split under a new root, so the tree grows at
+    the top and all leaves stay at the same depth. */
+    if(oSymTable->root->count==MAX_KEYS){
+        newRoot = Node_new(0);
+        if(newRoot==NULL){
+            free(keyCopy);
+            return 0;
+        }
+        newRoot->children[0] = oSymTable->root;
+        if(!Node_split(newRoot, 0)){
+            free(newRoot);
+            free(keyCopy);
+            return 0;
+        }
+        oSymTable->root = newRoot;
+    }
+
+    /* Descend to the leaf the key belongs in, splitting full nodes on
+    the way down so that there is always room for a key moving up. A
+    failed split leaves a valid tree behind. */
+    node = oSymTable->root;
+    for(;;){
+        i = Node_search(node, pcKey, uPrefix, &iFound);
+        if(node->isLeaf){
+            break;
+        }
+        if(node->children[i]->count==MAX_KEYS){
+            if(!Node_split(node, i)){
+                free(keyCopy);
+                return 0;
+            }
+            if(Key_compare(pcKey, uPrefix, node->keys[i],
+                node->prefixes[i])>0){
+                i += 1;
+            }
+        }
+        node = node->children[i];
+    }
+
+    Node_shift(node, i, 1);
+    node->prefixes[i] = uPrefix;
+    node->keys[i] = keyCopy;
+    node->values[i] = pvValue;
+    node->count += 1;
+    oSymTable->length += 1;
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    struct Node *node;
+    unsigned int i;
+    const void *oldValue;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    node = SymTable_find(oSymTable, pcKey, &i);
+    if(node==NULL){
+        return NULL;
+    }
+
+    oldValue = node->values[i];
+    node->values[i] = pvValue;
+    return (void*)oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    unsigned int i;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    return SymTable_find(oSymTable, pcKey, &i)!=NULL;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct Node *node;
+    unsigned int i;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    node = SymTable_find(oSymTable, pcKey, &i);
+    if(node==NULL){
+        return NULL;
+    }
+    return (void*)node->values[i];
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct Node *oldRoot;
+    const char *removedKey;
+    const void *removedValue;
+    int iFound;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    iFound = Node_remove(oSymTable->root, pcKey, Key_prefix(pcKey),
+        &removedKey, &removedValue);
+
+    /* A root emptied by a merge below it gives way to its only child,
+    so the tree shrinks at the top. */
+    if(oSymTable->root->count==0 && !oSymTable->root->isLeaf){
+        oldRoot = oSymTable->root;
+        oSymTable->root = oldRoot->children[0];
+        free(oldRoot);
+    }
+
+    if(!iFound){
+        return NULL;
+    }
+    free((char*)removedKey);
+    oSymTable->length -= 1;
+    return (void*)removedValue;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra){
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    Node_map(oSymTable->root, pfApply, (void*)pvExtra);
+}
+
+const char *SymTable_lowerBound(SymTable_T oSymTable, const char *pcKey,
+     void **ppvValue){
+    struct Node *node;
+    struct Node *bestNode = NULL;
+    unsigned int bestIndex = 0;
+    uint64_t uPrefix;
+    unsigned int i;
+    int iFound;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    /* The answer is the key found, or else the smallest key greater
+    than pcKey met on the way down. */
+    uPrefix = Key_prefix(pcKey);
+    for(node = oSymTable->root; ; node = node->children[i]){
+        i = Node_search(node, pcKey, uPrefix, &iFound);
+        if(i<node->count){
+            bestNode = node;
+            bestIndex = i;
+        }
+        if(iFound || node->isLeaf){
+            break;
+        }
+    }
+
+    if(bestNode==NULL){
+        return NULL;
+    }
+    if(ppvValue!=NULL){
+        *ppvValue = (void*)bestNode->values[bestIndex];
+    }
+    return bestNode->keys[bestIndex];
+}
+
+void SymTable_mapRange(SymTable_T oSymTable,
+     const char *pcLow, const char *pcHigh,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra){
+    struct Bounds bounds;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    bounds.low = pcLow;
+    bounds.lowPrefix = pcLow==NULL ? 0 : Key_prefix(pcLow);
+    bounds.high = pcHigh;
+    bounds.highPrefix = pcHigh==NULL ? 0 : Key_prefix(pcHigh);
+    bounds.prefix = NULL;
+    bounds.prefixLength = 0;
+    bounds.pfApply = pfApply;
+    bounds.extra = (void*)pvExtra;
+    (void)Node_mapBounded(oSymTable->root, &bounds);
+}
+
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra){
+    struct Bounds bounds;
+
+    assert(oSymTable!=NULL);
+    assert(pcPrefix!=NULL);
+    assert(pfApply!=NULL);
+
+    /* The keys starting with pcPrefix are the ones from pcPrefix on,
+    up to the first that does not start with it. */
+    bounds.low = pcPrefix;
+    bounds.lowPrefix = Key_prefix(pcPrefix);
+    bounds.high = NULL;
+    bounds.highPrefix = 0;
+    bounds.prefix = pcPrefix;
+    bounds.prefixLength = strlen(pcPrefix);
+    bounds.pfApply = pfApply;
+    bounds.extra = (void*)pvExtra;
+    (void)Node_mapBounded(oSymTable->root, &bounds);
+}
@@ -0,0 +1,41 @@
+/* symtablebtree.h */
+/* Author: Vikram Kakaria */
+
+#ifndef SYMTABLEBTREE_H
+#define SYMTABLEBTREE_H
+
+#include "symtable.h"
+
+/* The functions below extend the SymTable interface, and are provided
+only by the B-tree implementation (symtablebtree.c), which keeps its
+bindings ordered by key. Keys are ordered as strcmp orders them. In
+that implementation SymTable_map, too, visits bindings in increasing
+order of key.
+
+pfApply must not change oSymTable while any of the functions below is
+calling it. */
+
+/* Return the smallest key in oSymTable that is not less than pcKey,
+and, if ppvValue is not NULL, set *ppvValue to its value. If there is
+no such key, return NULL and leave *ppvValue alone. The key returned
+belongs to oSymTable, and stays valid until its binding is removed. */
+const char *SymTable_lowerBound(SymTable_T oSymTable, const char *pcKey,
+     void **ppvValue);
+
+/* Apply function *pfApply to each binding in oSymTable whose key is
+not less than pcLow and less than pcHigh, in increasing order of key,
+passing pvExtra as an extra parameter. If pcLow is NULL, the range has
+no lower bound; if pcHigh is NULL, it has no upper bound. */
+void SymTable_mapRange(SymTable_T oSymTable,
+     const char *pcLow, const char *pcHigh,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra);
+
+/* Apply function *pfApply to each binding in oSymTable whose key
+starts with pcPrefix, in increasing order of key, passing pvExtra as
+an extra parameter. */
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra);
+
+#endif
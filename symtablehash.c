@@ -1,54 +1,760 @@
 /* symtablehash.c */
 /* Author: Vikram Kakaria */
 
-#include "symtable.h"
+/* SYMTABLE_RCU (see below) refines SYMTABLE_CONCURRENT, and the
+concurrent builds allocate tables with posix_memalign. */
+#if defined(SYMTABLE_RCU) && !defined(SYMTABLE_CONCURRENT)
+#define SYMTABLE_CONCURRENT
+#endif
+#ifdef SYMTABLE_CONCURRENT
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "symtablehash.h"
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#ifdef SYMTABLE_RCU
+#include <sched.h>
+#endif
+
+/* Number of buckets in a new SymTable that is meant to hold more
+than SMALL_BINDING_COUNT bindings. Bucket counts are always powers of
+two, and SymTable_expand doubles the count each time, for as long as
+memory allows. */
+#define INITIAL_BUCKET_COUNT 512
+
+/* Most tables stay tiny, so a table starts out small: its bindings
+share a single bucket held inside struct SymTable, and it allocates
+no bucket array. Once it is asked to hold more than
+SMALL_BINDING_COUNT bindings it takes on an array of buckets, and
+grows as usual from then on. */
+#define SMALL_BINDING_COUNT 8
 
-/* Gives each potential value for bucket counts, progressing
-from  primeBuckCounts[0] to primeBuckCounts[1] to the last
-index of the array. These can be seen as a form of boundaries, 
-which are handled by the SymTable_expand(SymTable_T oSymTable) 
-function. */
-static const size_t primeBuckCounts[] = {
-    509, 1021, 2039, 4093, 8191, 16381, 32749, 65521
-    };
+/* SymTable_remove halves the number of buckets once fewer than
+1/SHRINK_LOAD_DEN of them would be used, but never below
+INITIAL_BUCKET_COUNT. Halving leaves the table a quarter full, well
+clear of the expansion threshold, so a table whose length hovers near
+either threshold does not keep resizing. */
+#define SHRINK_LOAD_DEN 8
 
 /* A binding has a key and a value. It can be seen as linking
-to another binding. */
+to another binding. The key's characters are stored at the end of
+the binding itself, so each binding is a single allocation. */
 struct Binding {
-    /* Binding key */
-    const char *key; 
+    /* Next binding memory address */
+    struct Binding *next;
+
+    /* Full hash code of key, kept so that chains can be screened
+    and the table expanded without reading key strings again. */
+    size_t hash;
 
     /* Binding value */
     const void *value;
 
-    /* Next binding memory address */
-    struct Binding *next;
+    /* Number of characters in key, not counting the terminating
+    null character */
+    size_t keyLength;
+
+#ifdef SYMTABLE_RCU
+    /* Next removed binding of its stripe, while this one awaits 
+    being freed */
+    struct Binding *retired;
+#endif
+
+    /* Binding key, including its terminating null character */
+    char key[];
+};
+
+/* Bindings are carved out of per-table chunks, in multiples of
+ARENA_GRAIN bytes, which is enough alignment for struct Binding. */
+#define ARENA_GRAIN 8
+
+/* Bindings of up to ARENA_MAX_SMALL bytes are recycled through one
+free list per size; larger ones get a chunk of their own, which is
+freed as soon as the binding is removed. */
+#define ARENA_MAX_SMALL 256
+#define ARENA_NUM_CLASSES (ARENA_MAX_SMALL / ARENA_GRAIN + 1)
+
+/* Size of a table's first chunk. Each further chunk is twice the
+size of the one before, up to ARENA_MAX_CHUNK, so small tables stay
+small and large tables need few chunks. */
+#define ARENA_FIRST_CHUNK 1024
+#define ARENA_MAX_CHUNK 65536
+
+/* The header at the start of every chunk. Chunks are doubly linked
+so that a binding's own chunk can be unlinked when it is removed. */
+struct Chunk {
+    /* Previous chunk, or NULL if this is the first */
+    struct Chunk *prev;
+
+    /* Next chunk, or NULL if this is the last */
+    struct Chunk *next;
+};
+
+/* Offset from the start of a chunk to its first binding. */
+#define CHUNK_HEADER_SIZE ((sizeof(struct Chunk) + ARENA_GRAIN - 1) \
+    & ~(size_t)(ARENA_GRAIN - 1))
+
+/* An Arena owns the memory of every binding in one SymTable. It
+hands out bindings from its current chunk, reuses removed bindings of
+the same size, and is released chunk by chunk. */
+struct Arena {
+    /* All chunks owned by the arena */
+    struct Chunk *chunks;
+
+    /* Next unused byte of the current chunk */
+    char *next;
+
+    /* Number of unused bytes left in the current chunk */
+    size_t left;
+
+    /* Size of the next chunk to allocate */
+    size_t nextChunkSize;
+
+    /* Removed bindings, by size in grains, linked through next */
+    struct Binding *freeLists[ARENA_NUM_CLASSES];
+};
+
+/* Return the number of bytes the arena uses for a binding whose key
+occupies uKeySize bytes, terminating null character included. */
+static size_t Arena_bindingSize(size_t uKeySize){
+    size_t size = offsetof(struct Binding, key) + uKeySize;
+    return (size + ARENA_GRAIN - 1) & ~(size_t)(ARENA_GRAIN - 1);
+}
+
+/* Initialize poArena to own no memory. */
+static void Arena_init(struct Arena *poArena){
+    size_t sizeClass;
+
+    poArena->chunks = NULL;
+    poArena->next = NULL;
+    poArena->left = 0;
+    poArena->nextChunkSize = ARENA_FIRST_CHUNK;
+    for(sizeClass=0; sizeClass<ARENA_NUM_CLASSES; sizeClass++){
+        poArena->freeLists[sizeClass] = NULL;
+    }
+}
+
+/* Allocate a chunk able to hold uSize bytes of bindings, and link it
+into poArena. Return the chunk, or NULL if not enough memory is
+available. */
+static struct Chunk *Arena_addChunk(struct Arena *poArena,
+     size_t uSize){
+    struct Chunk *chunk;
+
+    chunk = (struct Chunk*)malloc(CHUNK_HEADER_SIZE + uSize);
+    if(chunk==NULL){
+        return NULL;
+    }
+    chunk->prev = NULL;
+    chunk->next = poArena->chunks;
+    if(poArena->chunks!=NULL){
+        poArena->chunks->prev = chunk;
+    }
+    poArena->chunks = chunk;
+    return chunk;
+}
+
+/* Return memory from poArena for a binding whose key occupies
+uKeySize bytes, or NULL if not enough memory is available. */
+static struct Binding *Arena_alloc(struct Arena *poArena,
+     size_t uKeySize){
+    size_t size = Arena_bindingSize(uKeySize);
+    struct Binding *binding;
+    struct Chunk *chunk;
+
+    /* Large bindings live alone in a chunk of their own. */
+    if(size > ARENA_MAX_SMALL){
+        chunk = Arena_addChunk(poArena, size);
+        if(chunk==NULL){
+            return NULL;
+        }
+        return (struct Binding*)((char*)chunk + CHUNK_HEADER_SIZE);
+    }
+
+    /* Reuse a removed binding of the same size if there is one. */
+    binding = poArena->freeLists[size / ARENA_GRAIN];
+    if(binding!=NULL){
+        poArena->freeLists[size / ARENA_GRAIN] = binding->next;
+        return binding;
+    }
+
+    /* Otherwise carve it from the current chunk, starting a new chunk
+    if the current one is used up. What is left of the old chunk is
+    abandoned until the arena is freed. */
+    if(poArena->left < size){
+        chunk = Arena_addChunk(poArena, poArena->nextChunkSize);
+        if(chunk==NULL){
+            return NULL;
+        }
+        poArena->next = (char*)chunk + CHUNK_HEADER_SIZE;
+        poArena->left = poArena->nextChunkSize;
+        if(poArena->nextChunkSize < ARENA_MAX_CHUNK){
+            poArena->nextChunkSize *= 2;
+        }
+    }
+    binding = (struct Binding*)poArena->next;
+    poArena->next += size;
+    poArena->left -= size;
+    return binding;
+}
+
+/* Make sure that the current chunk of poArena has at least uSize
+unused bytes, so that small bindings adding up to that size can be
+carved from it without further calls to malloc. If a new chunk is
+needed, what is left of the current one is abandoned. Return 1 (for
+true) on success, or 0 (for false) if not enough memory is available,
+in which case poArena does not change. The concurrent build, whose 
+bindings come from many arenas, has no use for it. */
+#ifndef SYMTABLE_CONCURRENT
+static int Arena_reserve(struct Arena *poArena, size_t uSize){
+    struct Chunk *chunk;
+
+    if(poArena->left >= uSize){
+        return 1;
+    }
+    if(uSize > ((size_t)-1) - CHUNK_HEADER_SIZE){
+        return 0;
+    }
+    chunk = Arena_addChunk(poArena, uSize);
+    if(chunk==NULL){
+        return 0;
+    }
+    poArena->next = (char*)chunk + CHUNK_HEADER_SIZE;
+    poArena->left = uSize;
+    return 1;
+}
+#endif
+
+/* Give the memory of poBinding, whose key occupies uKeySize bytes,
+back to poArena. */
+static void Arena_release(struct Arena *poArena,
+     struct Binding *poBinding, size_t uKeySize){
+    size_t size = Arena_bindingSize(uKeySize);
+    struct Chunk *chunk;
+
+    if(size > ARENA_MAX_SMALL){
+        chunk = (struct Chunk*)((char*)poBinding - CHUNK_HEADER_SIZE);
+        if(chunk->prev!=NULL){
+            chunk->prev->next = chunk->next;
+        }
+        else{
+            poArena->chunks = chunk->next;
+        }
+        if(chunk->next!=NULL){
+            chunk->next->prev = chunk->prev;
+        }
+        free(chunk);
+        return;
+    }
+
+    poBinding->next = poArena->freeLists[size / ARENA_GRAIN];
+    poArena->freeLists[size / ARENA_GRAIN] = poBinding;
+}
+
+/* Free all memory owned by poArena, and with it every binding that
+was allocated from it. */
+static void Arena_free(struct Arena *poArena){
+    struct Chunk *chunk;
+    struct Chunk *nextChunk;
+
+    for(chunk = poArena->chunks; chunk != NULL; chunk = nextChunk){
+        nextChunk = chunk->next;
+        free(chunk);
+    }
+}
+
+/* Number of old buckets that are moved into the new bucket array by
+each SymTable_put or SymTable_remove while the table is resizing. */
+#define MIGRATE_STEP 8
+
+/* Number of keys SymTable_getBatch has in flight at once. The memory
+reads for a group of keys are all started before any of them is
+waited for. */
+#define BATCH_GROUP 16
+
+/* Fewest buckets for which SymTable_mapParallel starts a thread. A
+table with fewer buckets for each thread is walked by the calling
+thread alone, since starting threads would cost more than it saves. */
+#define PARALLEL_MIN_BUCKETS 4096
+
+/* Hint that the memory at p will soon be read, so that the read can
+overlap other work. It has no effect on the results. */
+#ifdef __GNUC__
+#define SymTable_prefetch(p) __builtin_prefetch(p)
+#else
+#define SymTable_prefetch(p) ((void)(p))
+#endif
+
+/* Chains may be built to be self-organizing, so that keys looked up 
+often drift toward the head of their chain and are found sooner. If 
+SYMTABLE_MOVE_TO_FRONT is defined, a binding that a lookup finds is 
+moved to the head of its chain. If SYMTABLE_TRANSPOSE is defined 
+instead, it is swapped with the binding before it, which adapts more 
+slowly but is not thrown off by keys that are looked up only once. 
+Lookups are those of SymTable_get, SymTable_contains, SymTable_replace 
+and SymTable_find and their n variants; SymTable_getBatch leaves chains 
+as they are. Bindings never move in memory, so handles are unaffected. */
+#if defined(SYMTABLE_MOVE_TO_FRONT) && defined(SYMTABLE_TRANSPOSE)
+#error "Define at most one of SYMTABLE_MOVE_TO_FRONT and SYMTABLE_TRANSPOSE"
+#endif
+
+/* If SYMTABLE_CONCURRENT is defined, a table may be shared by threads:
+any number of them may call the functions of symtable.h other than
+SymTable_new and SymTable_free, the n variants, SymTable_getOrPut,
+SymTable_putOrReplace, the batch functions, SymTable_reserve,
+SymTable_shrinkToFit, SymTable_mapParallel and the functions on
+handles on the same table at once. The iterator functions must not
+overlap other calls on the table, and a handle must not be used once
+another thread may have removed its binding.
+
+The table is then guarded by LOCK_STRIPES locks. The stripe of a key
+is given by the low bits of its hash code, and a table never has fewer
+buckets than stripes, so each chain belongs to a single stripe, both
+before and after a resize: SymTable_get, SymTable_put and
+SymTable_remove on keys of different stripes proceed in parallel. Each
+stripe allocates its bindings from an arena of its own. Resizing takes
+every stripe, in order, and moves all of the bindings at once, so no
+resize is ever seen half done; it is carried out by the first thread
+to find the table full or sparse once it has released its own stripe.
+SymTable_map and SymTable_mapParallel, too, take every stripe, so
+pfApply must not call any function on the table. Small tables and
+inline slots, whose sharing of storage across keys would defeat the
+striping, are not used.
+
+If SYMTABLE_RCU is defined as well, the table is tuned for tables that
+are read far more often than they are changed. SymTable_get,
+SymTable_contains, their n variants and SymTable_getBatch then take no
+lock and write no memory that another thread reads: each reader only
+counts itself in and out of a slot of its own (see struct ReaderSlot).
+Writers still take stripes, and publish each change to a chain or a
+value with a single atomic store, so a reader sees a chain either
+before or after it. A removed binding may still be read by a reader
+that reached it first, so it is only retired, and its stripe frees its
+retired bindings RETIRE_BATCH at a time, once every reader that was
+counted in when they were retired has counted out (see
+SymTable_synchronize). A resize makes resizeCount odd while it runs,
+and readers that overlap one try again; the old bucket array is
+freed, too, only once no reader can be using it, which is waited for
+after the resize has released the stripes. Self-organizing
+chains cannot be combined with SYMTABLE_RCU, since readers must not
+reorder them.
+
+Without SYMTABLE_CONCURRENT, there is a single stripe, which is never
+locked. */
+#ifdef SYMTABLE_CONCURRENT
+#ifndef __GNUC__
+#error "SYMTABLE_CONCURRENT needs the __atomic builtins of GCC or Clang"
+#endif
+#define LOCK_STRIPES 64
+
+/* Memory that different threads write is kept in separate cache 
+lines, so that they do not take the lines from each other. */
+#define CACHE_LINE_SIZE 64
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#else
+#define LOCK_STRIPES 1
+#define CACHE_ALIGNED
+#endif
+
+#ifdef SYMTABLE_RCU
+#if defined(SYMTABLE_MOVE_TO_FRONT) || defined(SYMTABLE_TRANSPOSE)
+#error "SYMTABLE_RCU cannot be combined with self-organizing chains"
+#endif
+
+/* Number of reader slots of a table. Threads are given slots in turn, 
+so a slot is shared only by threads READER_SLOTS apart. */
+#define READER_SLOTS 64
+
+/* Number of retired bindings a stripe collects before it waits for 
+the readers and frees them. */
+#define RETIRE_BATCH 64
+
+/* A slot in which readers count themselves in and out. Readers that 
+arrive while the epoch of the table is even count themselves in 
+count[0], and the others in count[1]. */
+struct ReaderSlot {
+    /* The number of readers of each parity in the slot */
+    size_t count[2] CACHE_ALIGNED;
+};
+
+/* Store uValue at *pLocation, or load the value at pLocation, where 
+readers may load it at the same time. */
+#define SymTable_store(pLocation, uValue) \
+    __atomic_store_n((pLocation), (uValue), __ATOMIC_RELEASE)
+#define SymTable_load(pLocation) \
+    __atomic_load_n((pLocation), __ATOMIC_ACQUIRE)
+#else
+#define SymTable_store(pLocation, uValue) ((void)(*(pLocation) = (uValue)))
+#define SymTable_load(pLocation) (*(pLocation))
+#endif
+
+/* A stripe of a table: the lock over its keys' chains, and the owner
+of the memory of their bindings. */
+struct Stripe {
+#ifdef SYMTABLE_CONCURRENT
+    /* Held while the stripe's chains are read or changed */
+    pthread_mutex_t lock CACHE_ALIGNED;
+#endif
+
+    /* Owner of the memory of every binding of the stripe that is not
+    in an inline slot */
+    struct Arena arena;
+
+#ifdef SYMTABLE_RCU
+    /* The bindings removed from the stripe that are yet to be freed,
+    linked through retired */
+    struct Binding *retired;
+
+    /* The number of bindings in retired */
+    size_t retiredCount;
+#endif
 };
 
 /* A SymTable (indicating a symbol table) consists of bindings 
 that are linked together. In a hash table representation, there 
 are buckets present. The SymTable, in particular, is pointing
 to the array of buckets. The number of bindings, as well as 
-the number of buckets, are noted. */
+the number of buckets, are noted.
+
+Resizing is incremental: while it is under way, the previous bucket
+array is kept as well, and its buckets are moved over a few at a time.
+A key lives in the old array if its old bucket has not been moved yet,
+and in the new array otherwise, so every lookup still walks exactly one
+chain. */
 struct SymTable {
     /* An array of buckets, where each bucket is functionally
     similar to a linked list. */
     struct Binding **buckets;
-    
-    /* Tells number of bindings present. */
-    size_t length;
 
     /* Tells number of buckets present. */
     size_t numBuckets;
+
+    /* The bucket array being emptied into buckets, or NULL if no
+    resize is under way. */
+    struct Binding **oldBuckets;
+
+    /* Tells number of buckets in oldBuckets. */
+    size_t numOldBuckets;
+
+    /* Old buckets with an index below this have been moved. */
+    size_t migrateIndex;
+
+    /* The only bucket of a small table, which buckets (or oldBuckets,
+    while the table grows out of it) then points to. */
+    struct Binding *smallBucket;
+
+    /* Bit i is set if inline slot i is unused. */
+    unsigned int inlineFree;
+
+    /* The hash function chosen for the table's keys. */
+    size_t (*pfHash)(const char *pcKey, size_t uLength);
+
+#ifdef SYMTABLE_RCU
+    /* The number of resizes begun and finished; odd while one is 
+    under way. */
+    size_t resizeCount;
+
+    /* The number of grace periods begun; its parity tells arriving
+    readers which count of their slot to count themselves in. */
+    unsigned int epoch;
+
+    /* An old bucket array that the resize under way has emptied, 
+    which SymTable_endResize detaches to be freed once no reader can 
+    be using it, or NULL. */
+    struct Binding **retiredBuckets;
+#endif
+
+    /* Tells number of bindings present. Every put and remove changes 
+    it, so in the concurrent build it is kept apart from the fields 
+    above, which readers read. */
+    size_t length CACHE_ALIGNED;
+
+#ifdef SYMTABLE_RCU
+    /* Held while waiting for readers, so that one thread at a time 
+    advances the epoch. */
+    pthread_mutex_t reclaimLock;
+#endif
+
+    /* The stripes of the table, selected by the low bits of the
+    keys' hash codes. */
+    struct Stripe stripes[LOCK_STRIPES];
+
+#ifdef SYMTABLE_RCU
+    /* The slots in which readers count themselves in and out */
+    struct ReaderSlot readers[READER_SLOTS];
+#endif
 };
 
-/* Return a hash code for pcKey that is between 0 and uBucketCount-1,
-   inclusive. */
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount)
+/* The first INLINE_BINDING_COUNT bindings of a table whose keys,
+terminating null character included, fit in INLINE_KEY_SIZE bytes are
+kept in inline slots, which are allocated along with struct SymTable
+right after it. A small table with short keys therefore needs no
+allocation besides its own. Like any other binding, a binding in an
+inline slot never moves, even as the table grows. */
+#ifdef SYMTABLE_CONCURRENT
+#define INLINE_BINDING_COUNT 0
+#else
+#define INLINE_BINDING_COUNT SMALL_BINDING_COUNT
+#endif
+#define INLINE_KEY_SIZE 16
+
+/* Size of an inline slot, and offset of the first one from the start
+of struct SymTable. */
+#define INLINE_SLOT_SIZE ((offsetof(struct Binding, key) \
+    + INLINE_KEY_SIZE + ARENA_GRAIN - 1) & ~(size_t)(ARENA_GRAIN - 1))
+#define INLINE_OFFSET ((sizeof(struct SymTable) + ARENA_GRAIN - 1) \
+    & ~(size_t)(ARENA_GRAIN - 1))
+
+/* Return inline slot uSlot of oSymTable. */
+static struct Binding *SymTable_inlineSlot(SymTable_T oSymTable,
+     unsigned int uSlot){
+    return (struct Binding*)((char*)oSymTable + INLINE_OFFSET
+        + uSlot * INLINE_SLOT_SIZE);
+}
+
+/* Return the stripe of oSymTable that keys whose hash code is uHash 
+belong to. */
+static struct Stripe *SymTable_stripe(SymTable_T oSymTable, 
+     size_t uHash){
+    return &(oSymTable->stripes)[uHash & (LOCK_STRIPES - 1)];
+}
+
+/* Acquire the lock of poStripe, in the concurrent build. */
+static void Stripe_lock(struct Stripe *poStripe){
+#ifdef SYMTABLE_CONCURRENT
+    (void)pthread_mutex_lock(&poStripe->lock);
+#else
+    (void)poStripe;
+#endif
+}
+
+/* Release the lock of poStripe, in the concurrent build. */
+static void Stripe_unlock(struct Stripe *poStripe){
+#ifdef SYMTABLE_CONCURRENT
+    (void)pthread_mutex_unlock(&poStripe->lock);
+#else
+    (void)poStripe;
+#endif
+}
+
+/* Acquire the locks of every stripe of oSymTable, in order, so that 
+the whole table can be read or changed. */
+static void SymTable_lockAll(SymTable_T oSymTable){
+    size_t stripe;
+
+    for(stripe = 0; stripe < LOCK_STRIPES; stripe++){
+        Stripe_lock(&(oSymTable->stripes)[stripe]);
+    }
+}
+
+/* Release the locks that SymTable_lockAll acquired. */
+static void SymTable_unlockAll(SymTable_T oSymTable){
+    size_t stripe;
+
+    for(stripe = 0; stripe < LOCK_STRIPES; stripe++){
+        Stripe_unlock(&(oSymTable->stripes)[stripe]);
+    }
+}
+
+/* Return the number of bindings in oSymTable. Stripes change it 
+without holding each other's locks, so in the concurrent build it is 
+read atomically. */
+static size_t SymTable_loadLength(SymTable_T oSymTable){
+#ifdef SYMTABLE_CONCURRENT
+    return __atomic_load_n(&oSymTable->length, __ATOMIC_RELAXED);
+#else
+    return oSymTable->length;
+#endif
+}
+
+/* Add iDelta, which is 1 or -1, to the number of bindings in 
+oSymTable. */
+static void SymTable_addLength(SymTable_T oSymTable, int iDelta){
+#ifdef SYMTABLE_CONCURRENT
+    (void)__atomic_fetch_add(&oSymTable->length, (size_t)iDelta, 
+    __ATOMIC_RELAXED);
+#else
+    oSymTable->length += (size_t)iDelta;
+#endif
+}
+
+/* Return memory in oSymTable for a binding whose key occupies
+uKeySize bytes and has hash code uHash, from an inline slot if 
+possible and from the arena of the key's stripe otherwise, or NULL if 
+not enough memory is available. */
+static struct Binding *SymTable_allocBinding(SymTable_T oSymTable,
+     size_t uHash, size_t uKeySize){
+    unsigned int uSlot;
+
+    if(uKeySize<=INLINE_KEY_SIZE && oSymTable->inlineFree!=0){
+        for(uSlot=0; !(oSymTable->inlineFree & (1U<<uSlot)); uSlot++){
+        }
+        oSymTable->inlineFree &= ~(1U<<uSlot);
+        return SymTable_inlineSlot(oSymTable, uSlot);
+    }
+    return Arena_alloc(&SymTable_stripe(oSymTable, uHash)->arena, 
+    uKeySize);
+}
+
+/* Give the memory of poBinding back to oSymTable at once. */
+static void SymTable_freeBinding(SymTable_T oSymTable,
+     struct Binding *poBinding){
+    uintptr_t uFirst = (uintptr_t)SymTable_inlineSlot(oSymTable, 0);
+    uintptr_t uBinding = (uintptr_t)poBinding;
+
+    if(uBinding>=uFirst
+        && uBinding<uFirst + INLINE_BINDING_COUNT * INLINE_SLOT_SIZE){
+        oSymTable->inlineFree |=
+            1U<<(unsigned int)((uBinding - uFirst) / INLINE_SLOT_SIZE);
+        return;
+    }
+    Arena_release(&SymTable_stripe(oSymTable, poBinding->hash)->arena,
+        poBinding, poBinding->keyLength+1);
+}
+
+/* Give the memory of poBinding, which has just been removed from 
+oSymTable, back to oSymTable: at once, or, in the RCU build, once no 
+reader can be reading it, by retiring it to its stripe. The caller 
+holds the binding's stripe. */
+static void SymTable_releaseBinding(SymTable_T oSymTable,
+     struct Binding *poBinding){
+#ifdef SYMTABLE_RCU
+    struct Stripe *stripe = SymTable_stripe(oSymTable, poBinding->hash);
+
+    poBinding->retired = stripe->retired;
+    stripe->retired = poBinding;
+    stripe->retiredCount++;
+#else
+    SymTable_freeBinding(oSymTable, poBinding);
+#endif
+}
+
+#ifdef SYMTABLE_RCU
+/* The number of the calling thread among those that have read a 
+table, from 1, or 0 if it has not read one yet. */
+static __thread unsigned int uThreadNumber;
+
+/* The number of threads that have read a table. */
+static unsigned int uReaderThreads;
+
+/* Count the calling thread in as a reader of oSymTable, so that 
+nothing it reaches from now on is freed until it counts itself out 
+with SymTable_readEnd. Return its slot, and set *puParity to the count 
+of the slot it was counted in. */
+static struct ReaderSlot *SymTable_readBegin(SymTable_T oSymTable,
+     unsigned int *puParity){
+    struct ReaderSlot *slot;
+    unsigned int parity;
+
+    if(uThreadNumber==0){
+        uThreadNumber = __atomic_add_fetch(&uReaderThreads, 1,
+        __ATOMIC_RELAXED);
+    }
+    slot = &(oSymTable->readers)[uThreadNumber % READER_SLOTS];
+
+    /* A reader counted in under an epoch that has since ended might 
+    not be waited for by the grace period that ended it, so it checks 
+    the epoch again once counted in, and counts itself in anew if it 
+    has moved on. */
+    for(;;){
+        parity = __atomic_load_n(&oSymTable->epoch, __ATOMIC_RELAXED) & 1;
+        (void)__atomic_fetch_add(&slot->count[parity], 1, 
+        __ATOMIC_SEQ_CST);
+        if((__atomic_load_n(&oSymTable->epoch, __ATOMIC_SEQ_CST) & 1)
+            == parity){
+            break;
+        }
+        (void)__atomic_fetch_sub(&slot->count[parity], 1, 
+        __ATOMIC_RELEASE);
+    }
+    *puParity = parity;
+    return slot;
+}
+
+/* Count a reader out of poSlot, in which SymTable_readBegin counted it 
+in with parity uParity. */
+static void SymTable_readEnd(struct ReaderSlot *poSlot, 
+     unsigned int uParity){
+    (void)__atomic_fetch_sub(&poSlot->count[uParity], 1, 
+    __ATOMIC_RELEASE);
+}
+
+/* Wait until every reader that was counted in to oSymTable when this 
+function was called has counted itself out. Memory that such readers 
+might have reached, and that no reader can reach any more, can then 
+be freed. Readers arriving meanwhile are counted under the next 
+epoch, and not waited for. */
+static void SymTable_synchronize(SymTable_T oSymTable){
+    unsigned int parity;
+    size_t slot;
+
+    (void)pthread_mutex_lock(&oSymTable->reclaimLock);
+    parity = oSymTable->epoch & 1;
+    __atomic_store_n(&oSymTable->epoch, oSymTable->epoch + 1, 
+    __ATOMIC_SEQ_CST);
+    for(slot = 0; slot < READER_SLOTS; slot++){
+        while(__atomic_load_n(&(oSymTable->readers)[slot].count[parity],
+            __ATOMIC_SEQ_CST)!=0){
+            (void)sched_yield();
+        }
+    }
+    (void)pthread_mutex_unlock(&oSymTable->reclaimLock);
+}
+#endif
+
+#ifdef SYMTABLE_CONCURRENT
+/* If poStripe, which the caller holds, has retired RETIRE_BATCH 
+bindings, detach them from it and return them, linked through 
+retired, for SymTable_freeRetired to free. Otherwise return NULL. */
+static struct Binding *Stripe_takeRetired(struct Stripe *poStripe){
+#ifdef SYMTABLE_RCU
+    struct Binding *retired;
+
+    if(poStripe->retiredCount < RETIRE_BATCH){
+        return NULL;
+    }
+    retired = poStripe->retired;
+    poStripe->retired = NULL;
+    poStripe->retiredCount = 0;
+    return retired;
+#else
+    (void)poStripe;
+    return NULL;
+#endif
+}
+
+/* Free poRetired, a list of bindings that Stripe_takeRetired took 
+from poStripe of oSymTable, once no reader can be reading them. The 
+caller must not hold any stripe. */
+static void SymTable_freeRetired(SymTable_T oSymTable, 
+     struct Stripe *poStripe, struct Binding *poRetired){
+#ifdef SYMTABLE_RCU
+    struct Binding *next;
+
+    SymTable_synchronize(oSymTable);
+    Stripe_lock(poStripe);
+    for(; poRetired != NULL; poRetired = next){
+        next = poRetired->retired;
+        SymTable_freeBinding(oSymTable, poRetired);
+    }
+    Stripe_unlock(poStripe);
+#else
+    (void)oSymTable;
+    (void)poStripe;
+    (void)poRetired;
+#endif
+}
+#endif
+
+/* Return a hash code for the uLength characters at pcKey, using the
+   hash function from the assignment specification
+   (SYMTABLE_HASH_CLASSIC). */
+static size_t SymTable_hash(const char *pcKey, size_t uLength)
 {
    const size_t HASH_MULTIPLIER = 65599;
    size_t u;
@@ -56,30 +762,197 @@ static size_t SymTable_hash(const char *pcKey, size_t uBucketCount)
 
    assert(pcKey != NULL);
 
-   for (u = 0; pcKey[u] != '\0'; u++)
+   for (u = 0; u < uLength; u++)
       uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
 
-   return uHash % uBucketCount;
+   return uHash;
+}
+
+/* Return uWord rotated left by iBits bits, where 0 < iBits < 64. */
+static uint64_t SymTable_rotl(uint64_t uWord, int iBits){
+    return (uWord << iBits) | (uWord >> (64 - iBits));
+}
+
+/* Return a hash code for the uLength characters at pcKey
+(SYMTABLE_HASH_WIDE). The key is consumed 8 bytes at a time, each 
+word going through a multiply-rotate round, and the result is finished 
+with a full avalanche step (the round and finishing constants are 
+those of xxHash64), so every bit of the key affects every bit of the 
+hash code. */
+static size_t SymTable_hashWide(const char *pcKey, size_t uLength){
+    const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+    uint64_t uHash;
+    uint64_t uWord;
+
+    assert(pcKey != NULL);
+
+    /* The length is known up front, so no byte needs to be tested
+    for a terminator. */
+    uHash = PRIME5 + (uint64_t)uLength;
+
+    for(;;){
+        /* The last partial word is padded with zeros; mixing in the
+        length above keeps the padding from causing collisions. */
+        uWord = 0;
+        if(uLength>=8){
+            memcpy(&uWord, pcKey, 8);
+        }
+        else if(uLength>0){
+            memcpy(&uWord, pcKey, uLength);
+        }
+        else{
+            break;
+        }
+
+        uWord = SymTable_rotl(uWord * PRIME2, 31) * PRIME1;
+        uHash = SymTable_rotl(uHash ^ uWord, 27) * PRIME1 + PRIME4;
+
+        if(uLength<8){
+            break;
+        }
+        pcKey += 8;
+        uLength -= 8;
+    }
+
+    uHash ^= uHash >> 33;
+    uHash *= PRIME2;
+    uHash ^= uHash >> 29;
+    uHash *= PRIME3;
+    uHash ^= uHash >> 32;
+    return (size_t)uHash;
+}
+
+/* Return the bucket for hash code uHash in an array of uBucketCount
+buckets. uBucketCount is a power of two, so the low bits of uHash
+select the bucket without any division. */
+static size_t SymTable_bucket(size_t uHash, size_t uBucketCount){
+    return uHash & (uBucketCount - 1);
+}
+
+/* Return the smallest bucket count (a power of two) that can hold
+uCount bindings without triggering expansion, or 0 if such an array
+could not be addressed. That is 1, for a small table, if uCount is at
+most SMALL_BINDING_COUNT; in the concurrent build, it is never less 
+than LOCK_STRIPES. */
+static size_t SymTable_bucketCountFor(size_t uCount){
+    size_t uBucketCount = 1;
+
+#ifdef SYMTABLE_CONCURRENT
+    /* Each chain must belong to a single stripe. */
+    if(uCount<LOCK_STRIPES){
+        uCount = LOCK_STRIPES;
+    }
+#else
+    if(uCount<=SMALL_BINDING_COUNT){
+        return 1;
+    }
+#endif
+
+    while(uBucketCount < uCount){
+        if(uBucketCount > ((size_t)-1) / 2 / sizeof(struct Binding*)){
+            return 0;
+        }
+        uBucketCount *= 2;
+    }
+    return uBucketCount;
+}
+
+/* Free ppoBuckets, a bucket array of oSymTable, unless it is the
+small bucket inside oSymTable itself. */
+static void SymTable_freeBuckets(SymTable_T oSymTable,
+     struct Binding **ppoBuckets){
+    if(ppoBuckets!=&oSymTable->smallBucket){
+        free(ppoBuckets);
+    }
+}
+
+/* Free ppoBuckets, a bucket array of oSymTable that has been emptied: 
+at once, or, in the RCU build, after the resize under way, once no 
+reader can be using it (see SymTable_endResize). */
+static void SymTable_retireBuckets(SymTable_T oSymTable,
+     struct Binding **ppoBuckets){
+#ifdef SYMTABLE_RCU
+    assert(oSymTable->retiredBuckets==NULL);
+    oSymTable->retiredBuckets = ppoBuckets;
+#else
+    SymTable_freeBuckets(oSymTable, ppoBuckets);
+#endif
 }
 
 SymTable_T SymTable_new(void){
+    return SymTable_newWithHash(SYMTABLE_HASH_CLASSIC, 0);
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
+    return SymTable_newWithHash(SYMTABLE_HASH_CLASSIC, uCapacity);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashPolicy_T ePolicy,
+     size_t uCapacity){
     SymTable_T oSymTable;
+    size_t numBuckets;
+    size_t stripe;
+
+    /* Start small if that is enough room, and otherwise never below
+    the usual initial size. */
+    numBuckets = SymTable_bucketCountFor(uCapacity);
+    if(numBuckets==0){
+        return NULL;
+    }
+    if(numBuckets>1 && numBuckets<INITIAL_BUCKET_COUNT){
+        numBuckets=INITIAL_BUCKET_COUNT;
+    }
 
     /* Use memory allocation to create a SymTable_T of size of 
-    the SymTable data structure */
-    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+    the SymTable data structure, followed by its inline slots. In the 
+    concurrent build it starts on a cache line, as its cache-aligned 
+    fields assume. */
+#ifdef SYMTABLE_CONCURRENT
+    if(posix_memalign((void**)&oSymTable, CACHE_LINE_SIZE, 
+        INLINE_OFFSET + INLINE_BINDING_COUNT * INLINE_SLOT_SIZE)!=0){
+        return NULL;
+    }
+#else
+    oSymTable = (SymTable_T)malloc(INLINE_OFFSET 
+        + INLINE_BINDING_COUNT * INLINE_SLOT_SIZE);
 
     /* Not enough memory */
     if(oSymTable==NULL){
         return NULL;
     }
+#endif
 
     oSymTable->length=0;
-    oSymTable->numBuckets=primeBuckCounts[0];
+    oSymTable->numBuckets=numBuckets;
+    oSymTable->oldBuckets=NULL;
+    oSymTable->numOldBuckets=0;
+    oSymTable->migrateIndex=0;
+    oSymTable->inlineFree=(1U<<INLINE_BINDING_COUNT)-1;
+
+    switch(ePolicy){
+        case SYMTABLE_HASH_WIDE:
+            oSymTable->pfHash=SymTable_hashWide;
+            break;
+        case SYMTABLE_HASH_CLASSIC:
+        default:
+            oSymTable->pfHash=SymTable_hash;
+            break;
+    }
 
-    /* Calloc does NULL initialization for pointers. */
-    oSymTable->buckets=(struct Binding**)calloc(
-        oSymTable->numBuckets, sizeof(struct Binding*));
+    /* Calloc does NULL initialization for pointers. A small table
+    needs no array at all. */
+    oSymTable->smallBucket=NULL;
+    if(numBuckets==1){
+        oSymTable->buckets=&oSymTable->smallBucket;
+    }
+    else{
+        oSymTable->buckets=(struct Binding**)calloc(
+            oSymTable->numBuckets, sizeof(struct Binding*));
+    }
 
     /* Check if there is insufficient memory for bucket array */
     if(oSymTable->buckets==NULL){
@@ -87,285 +960,1212 @@ SymTable_T SymTable_new(void){
         return NULL;
     }
 
-    return oSymTable;
+#ifdef SYMTABLE_RCU
+    oSymTable->resizeCount=0;
+    oSymTable->epoch=0;
+    oSymTable->retiredBuckets=NULL;
+    memset(oSymTable->readers, 0, sizeof(oSymTable->readers));
+    if(pthread_mutex_init(&oSymTable->reclaimLock, NULL)!=0){
+        SymTable_freeBuckets(oSymTable, oSymTable->buckets);
+        free(oSymTable);
+        return NULL;
+    }
+#endif
+
+    for(stripe = 0; stripe < LOCK_STRIPES; stripe++){
+        Arena_init(&(oSymTable->stripes)[stripe].arena);
+#ifdef SYMTABLE_RCU
+        (oSymTable->stripes)[stripe].retired=NULL;
+        (oSymTable->stripes)[stripe].retiredCount=0;
+#endif
+#ifdef SYMTABLE_CONCURRENT
+        if(pthread_mutex_init(&(oSymTable->stripes)[stripe].lock, 
+            NULL)!=0){
+            while(stripe>0){
+                stripe--;
+                (void)pthread_mutex_destroy(
+                    &(oSymTable->stripes)[stripe].lock);
+            }
+#ifdef SYMTABLE_RCU
+            (void)pthread_mutex_destroy(&oSymTable->reclaimLock);
+#endif
+            SymTable_freeBuckets(oSymTable, oSymTable->buckets);
+            free(oSymTable);
+            return NULL;
+        }
+#endif
+    }
+
+    return oSymTable;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+    size_t stripe;
+
+    assert(oSymTable!=NULL);
+
+    /* Every binding lives in the arena of its stripe or in an inline 
+    slot, so the chains need not be walked, nor the retired bindings 
+    of the RCU build. */
+    for(stripe = 0; stripe < LOCK_STRIPES; stripe++){
+        Arena_free(&(oSymTable->stripes)[stripe].arena);
+#ifdef SYMTABLE_CONCURRENT
+        (void)pthread_mutex_destroy(&(oSymTable->stripes)[stripe].lock);
+#endif
+    }
+    SymTable_freeBuckets(oSymTable, oSymTable->buckets);
+    SymTable_freeBuckets(oSymTable, oSymTable->oldBuckets);
+#ifdef SYMTABLE_RCU
+    (void)pthread_mutex_destroy(&oSymTable->reclaimLock);
+#endif
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+    return SymTable_loadLength(oSymTable);
+}
+
+/* Return the address of the chain head of the bucket in which a key
+whose hash code is uHash lives in oSymTable, or would live if it were
+added. */
+static struct Binding **SymTable_chain(SymTable_T oSymTable,
+     size_t uHash){
+    size_t bucket;
+
+    if(oSymTable->oldBuckets!=NULL){
+        bucket = SymTable_bucket(uHash, oSymTable->numOldBuckets);
+        if(bucket>=oSymTable->migrateIndex){
+            return &(oSymTable->oldBuckets)[bucket];
+        }
+    }
+    bucket = SymTable_bucket(uHash, oSymTable->numBuckets);
+    return &(oSymTable->buckets)[bucket];
+}
+
+/* If oSymTable is resizing, move up to MIGRATE_STEP more of its old
+buckets into the new bucket array, and release the old array once it
+has been emptied. */
+static void SymTable_migrate(SymTable_T oSymTable){
+    size_t stop;
+    size_t newBucket;
+    struct Binding *thisBinding;
+    struct Binding *nextBinding;
+
+    if(oSymTable->oldBuckets==NULL){
+        return;
+    }
+
+    stop = oSymTable->migrateIndex + MIGRATE_STEP;
+    if(stop>oSymTable->numOldBuckets){
+        stop = oSymTable->numOldBuckets;
+    }
+
+    for(; oSymTable->migrateIndex<stop; oSymTable->migrateIndex++){
+        /* Iterates through all bindings in the bucket and assigns 
+        each to its new bucket. */
+        for(thisBinding = 
+        (oSymTable->oldBuckets)[oSymTable->migrateIndex]; 
+        thisBinding != NULL; thisBinding = nextBinding){
+            /* Cannot do thisBinding=thisBinding->next due to 
+            overwriting. */
+            nextBinding=thisBinding->next;
+            newBucket = SymTable_bucket(thisBinding->hash, 
+            oSymTable->numBuckets);
+            SymTable_store(&thisBinding->next, 
+            (oSymTable->buckets)[newBucket]);
+            SymTable_store(&(oSymTable->buckets)[newBucket], 
+            thisBinding);
+        }
+        SymTable_store(&(oSymTable->oldBuckets)[oSymTable->migrateIndex],
+        (struct Binding*)NULL);
+    }
+
+    if(oSymTable->migrateIndex==oSymTable->numOldBuckets){
+        SymTable_retireBuckets(oSymTable, oSymTable->oldBuckets);
+        oSymTable->oldBuckets=NULL;
+        oSymTable->numOldBuckets=0;
+        oSymTable->migrateIndex=0;
+    }
+}
+
+/* Finish any resize of oSymTable that is under way. */
+static void SymTable_finishMigration(SymTable_T oSymTable){
+    while(oSymTable->oldBuckets!=NULL){
+        SymTable_migrate(oSymTable);
+    }
+}
+
+/* This function seeks to give oSymTable uNewNumBuckets buckets, which
+must be a power of two, and which oSymTable must not be resizing
+already. If not enough memory is available, then the table is
+unchanged. If, however, enough memory is available, then a new bucket
+array is installed, and the bindings are moved into it gradually by
+SymTable_migrate. Return 1 if the new array was installed, or 0 if
+not. */
+static int SymTable_resize(SymTable_T oSymTable, size_t uNewNumBuckets){
+    struct Binding **newBuckets;
+
+    assert(oSymTable->oldBuckets==NULL);
+
+    /* Make newBuckets, allocating memory for each one, unless the
+    table is becoming small again */
+    if(uNewNumBuckets==1){
+        oSymTable->smallBucket = NULL;
+        newBuckets = &oSymTable->smallBucket;
+    }
+    else{
+        newBuckets = (struct Binding**)calloc(uNewNumBuckets, 
+        sizeof(struct Binding*));
+    }
+
+    /* No resize, so exit function. */
+    if(newBuckets==NULL){
+        return 0;
+    }
+
+    /* The current buckets become the old buckets, to be emptied
+    starting from the first one. */
+    oSymTable->oldBuckets = oSymTable->buckets;
+    oSymTable->numOldBuckets = oSymTable->numBuckets;
+    oSymTable->migrateIndex = 0;
+    SymTable_store(&oSymTable->buckets, newBuckets);
+    SymTable_store(&oSymTable->numBuckets, uNewNumBuckets);
+    return 1;
+}
+
+/* This function seeks to expand oSymTable by doubling the number 
+of buckets present, or, for a small table, by giving it the fewest 
+buckets that fit one more binding than it can hold. If not enough 
+memory is available, then the table is unchanged. */
+static void SymTable_expand(SymTable_T oSymTable){
+    if(oSymTable->numBuckets==1){
+        (void)SymTable_resize(oSymTable, 
+        SymTable_bucketCountFor(SMALL_BINDING_COUNT + 1));
+        return;
+    }
+
+    /* Check to make sure that the doubled array can still be
+    addressed. */
+    if((oSymTable->numBuckets) > 
+        ((size_t)-1) / 2 / sizeof(struct Binding*)){
+        return;
+    }
+    (void)SymTable_resize(oSymTable, oSymTable->numBuckets * 2);
+}
+
+/* Return 1 (for true) if oSymTable has too many bindings for its 
+buckets, and should expand before another is added, or 0 (for false) 
+otherwise. A table that is resizing already is not full. */
+static int SymTable_isFull(SymTable_T oSymTable){
+    size_t length = SymTable_loadLength(oSymTable);
+
+    return oSymTable->oldBuckets==NULL
+        && (oSymTable->numBuckets==1
+        ? length>=SMALL_BINDING_COUNT
+        : length>oSymTable->numBuckets);
+}
+
+/* Return 1 (for true) if oSymTable has so few bindings for its 
+buckets that it should shrink, or 0 (for false) otherwise. A table 
+that is resizing already is not sparse. */
+static int SymTable_isSparse(SymTable_T oSymTable){
+    return oSymTable->oldBuckets==NULL
+        && oSymTable->numBuckets>INITIAL_BUCKET_COUNT
+        && SymTable_loadLength(oSymTable)*SHRINK_LOAD_DEN
+        < oSymTable->numBuckets;
+}
+
+/* Begin a resize of oSymTable, which the caller holds every stripe 
+of. In the RCU build, readers that overlap it try again once it ends, 
+since they might miss bindings it moves. */
+static void SymTable_beginResize(SymTable_T oSymTable){
+#ifdef SYMTABLE_RCU
+    __atomic_store_n(&oSymTable->resizeCount, oSymTable->resizeCount+1,
+    __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#else
+    (void)oSymTable;
+#endif
+}
+
+/* End the resize of oSymTable that SymTable_beginResize began, which 
+must have been finished. In the RCU build, return the bucket array it 
+emptied, detached from oSymTable, for SymTable_freeResized to free 
+once the caller has released every stripe; otherwise return NULL. */
+static struct Binding **SymTable_endResize(SymTable_T oSymTable){
+#ifdef SYMTABLE_RCU
+    struct Binding **retiredBuckets = oSymTable->retiredBuckets;
+
+    assert(oSymTable->oldBuckets==NULL);
+    __atomic_store_n(&oSymTable->resizeCount, oSymTable->resizeCount+1,
+    __ATOMIC_RELEASE);
+    oSymTable->retiredBuckets = NULL;
+    return retiredBuckets;
+#else
+    (void)oSymTable;
+    return NULL;
+#endif
+}
+
+/* Free ppoRetired, which SymTable_endResize returned for oSymTable, 
+once no reader can be using it. The caller must not hold any stripe, 
+so that puts and removes go on while the readers are waited for. */
+static void SymTable_freeResized(SymTable_T oSymTable,
+     struct Binding **ppoRetired){
+#ifdef SYMTABLE_RCU
+    if(ppoRetired!=NULL){
+        SymTable_synchronize(oSymTable);
+        SymTable_freeBuckets(oSymTable, ppoRetired);
+    }
+#else
+    (void)oSymTable;
+    (void)ppoRetired;
+#endif
+}
+
+/* Release the stripe of oSymTable that keys whose hash code is uHash 
+belong to, which the caller acquired to add or remove a binding. In 
+the concurrent build the table is then expanded, if it is full, or 
+shrunk, if it is sparse; that takes every stripe, which the caller 
+could not acquire while holding one. In the RCU build the bindings the 
+stripe has retired are also freed, once there are enough of them to be 
+worth a grace period. Without SYMTABLE_CONCURRENT, SymTable_insert and 
+SymTable_unlink resize the table themselves. */
+static void SymTable_unlockAndResize(SymTable_T oSymTable, size_t uHash){
+#ifdef SYMTABLE_CONCURRENT
+    struct Stripe *stripe = SymTable_stripe(oSymTable, uHash);
+    struct Binding *retired;
+    struct Binding **retiredBuckets;
+    int iResize;
+
+    iResize = SymTable_isFull(oSymTable) || SymTable_isSparse(oSymTable);
+    retired = Stripe_takeRetired(stripe);
+    Stripe_unlock(stripe);
+    if(retired!=NULL){
+        SymTable_freeRetired(oSymTable, stripe, retired);
+    }
+    if(!iResize){
+        return;
+    }
+
+    /* Another thread may have resized the table in the meantime. */
+    SymTable_lockAll(oSymTable);
+    SymTable_beginResize(oSymTable);
+    if(SymTable_isFull(oSymTable)){
+        SymTable_expand(oSymTable);
+    }
+    else if(SymTable_isSparse(oSymTable)){
+        (void)SymTable_resize(oSymTable, oSymTable->numBuckets/2);
+    }
+    SymTable_finishMigration(oSymTable);
+    retiredBuckets = SymTable_endResize(oSymTable);
+    SymTable_unlockAll(oSymTable);
+    SymTable_freeResized(oSymTable, retiredBuckets);
+#else
+    Stripe_unlock(SymTable_stripe(oSymTable, uHash));
+#endif
+}
+
+void SymTable_shrinkToFit(SymTable_T oSymTable){
+    struct Binding **retiredBuckets;
+    size_t newNumBuckets;
+
+    assert(oSymTable!=NULL);
+
+    SymTable_lockAll(oSymTable);
+    SymTable_beginResize(oSymTable);
+    SymTable_finishMigration(oSymTable);
+
+    newNumBuckets = SymTable_bucketCountFor(oSymTable->length);
+    if(newNumBuckets < oSymTable->numBuckets){
+        (void)SymTable_resize(oSymTable, newNumBuckets);
+        SymTable_finishMigration(oSymTable);
+    }
+    retiredBuckets = SymTable_endResize(oSymTable);
+    SymTable_unlockAll(oSymTable);
+    SymTable_freeResized(oSymTable, retiredBuckets);
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
+    struct Binding **retiredBuckets = NULL;
+    size_t newNumBuckets;
+    int iSuccessful = 1;
+
+    assert(oSymTable!=NULL);
+
+    newNumBuckets = SymTable_bucketCountFor(uCapacity);
+    if(newNumBuckets==0){
+        return 0;
+    }
+
+    SymTable_lockAll(oSymTable);
+    if(newNumBuckets > oSymTable->numBuckets){
+        /* A bucket array being emptied must be done with before the
+        table can take on another one. */
+        SymTable_beginResize(oSymTable);
+        SymTable_finishMigration(oSymTable);
+        iSuccessful = SymTable_resize(oSymTable, newNumBuckets);
+        SymTable_finishMigration(oSymTable);
+        retiredBuckets = SymTable_endResize(oSymTable);
+    }
+    SymTable_unlockAll(oSymTable);
+    SymTable_freeResized(oSymTable, retiredBuckets);
+    return iSuccessful;
 }
 
-void SymTable_free(SymTable_T oSymTable){
-    size_t bucketNumber;
-    struct Binding *thisBinding;
-    struct Binding *nextBinding;
-    
-    assert(oSymTable!=NULL);
+/* Return 1 (for true) if poBinding's key is the uLength characters at
+pcKey, whose hash code is uHash, or 0 (for false) otherwise. Hash codes
+and lengths are compared first, so the characters are rarely read. */
+static int SymTable_matches(const struct Binding *poBinding,
+     const char *pcKey, size_t uLength, size_t uHash){
+    return poBinding->hash==uHash && poBinding->keyLength==uLength
+        && memcmp(pcKey, poBinding->key, uLength)==0;
+}
 
-    /* Create a looping condition: first set current binding
-    equal to table's first binding. Until the current binding
-    is not NULL, loop through and then set the current binding
-    to the next binding. */
-    for(bucketNumber=0; bucketNumber<(oSymTable->numBuckets); 
-    bucketNumber++){
-        for(thisBinding = (oSymTable->buckets)[bucketNumber];
-        thisBinding != NULL; thisBinding = nextBinding){
-            nextBinding = thisBinding->next;
-            free((char*)thisBinding->key);
-            free(thisBinding);
+/* Return the binding in the chain starting at binding whose key is 
+the uLength characters at pcKey, whose hash code is uHash, or NULL if 
+there is no such binding. In the RCU build the chain may be changing 
+meanwhile. */
+static struct Binding *SymTable_scan(struct Binding *binding,
+     const char *pcKey, size_t uLength, size_t uHash){
+    for(; binding != NULL; binding = SymTable_load(&binding->next)){
+        if(SymTable_matches(binding, pcKey, uLength, uHash)){
+            return binding;
         }
     }
-    free(oSymTable->buckets);
-    free(oSymTable);
+    return NULL;
 }
 
-size_t SymTable_getLength(SymTable_T oSymTable){
-    assert(oSymTable!=NULL);
-    return oSymTable->length;
-}
+/* Move the binding *link points to toward the head of the chain 
+*head, as the self-organizing mode chosen above requires. previousLink 
+points to the link to the binding before it, or is NULL if it is the 
+first. */
+static void SymTable_promote(struct Binding **head,
+     struct Binding **previousLink, struct Binding **link){
+    struct Binding *binding = *link;
 
-/* This function seeks to expand oSymTable by increasing the number 
-of buckets present. If not enough memory is available, then the table 
-is unchanged. If, however, enough memory is available for expansion, 
-then it is expanded. */
-static void SymTable_expand(SymTable_T oSymTable){
-    size_t newNumBuckets;
-    size_t bucket;
-    size_t newBucket;
-    struct Binding **newBuckets;
-    struct Binding *thisBinding;
-    struct Binding *nextBinding;
-    int index=0;
-    
-    /* Find newNumBuckets by going through primeBuckCounts array. Find 
-    index of current bucket count and add 1 to it. */
-    while(primeBuckCounts[index]!=(oSymTable->numBuckets)){
-        index+=1;
+#if defined(SYMTABLE_MOVE_TO_FRONT)
+    (void)previousLink;
+    *link = binding->next;
+    binding->next = *head;
+    *head = binding;
+#elif defined(SYMTABLE_TRANSPOSE)
+    (void)head;
+    if(previousLink!=NULL){
+        *link = binding->next;
+        binding->next = *previousLink;
+        *previousLink = binding;
     }
-    newNumBuckets=primeBuckCounts[index+1];
+#else
+    (void)head;
+    (void)previousLink;
+    (void)binding;
+#endif
+}
 
-    /* Make newBuckets, allocating memory for each one */
-    newBuckets = (struct Binding**)calloc(newNumBuckets, 
-    sizeof(struct Binding*));
+/* Return the binding in oSymTable whose key is the uLength characters
+at pcKey, whose hash code is uHash, or NULL if there is no such 
+binding. The binding found is promoted first. The caller holds the 
+key's stripe. */
+static struct Binding *SymTable_lookup(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength, size_t uHash){
+    struct Binding **chain;
+    struct Binding **previousLink;
+    struct Binding **link;
+    struct Binding *binding;
 
-    /* No expansion, so exit function. */
-    if(newBuckets==NULL){
-        return;
-    }
+    chain = SymTable_chain(oSymTable, uHash);
 
-    /* Hashing, iterating through bucket array for all buckets */
-    for(bucket=0; bucket<(oSymTable->numBuckets); bucket++){
-        /* Iterates through all bindings in each bucket and assigns 
-        to new bucket. */
-        for(thisBinding = (oSymTable->buckets)[bucket]; 
-        thisBinding != NULL; thisBinding = nextBinding){
-            /* Cannot do thisBinding=thisBinding->next due to 
-            overwriting. */
-            nextBinding=thisBinding->next;
-            newBucket = SymTable_hash(thisBinding->key, newNumBuckets);
-            /* First binding in the bucket */
-            thisBinding->next=newBuckets[newBucket];
-            /* Making thisBinding first */
-            newBuckets[newBucket]=thisBinding;
+    previousLink = NULL;
+    for(link = chain; *link != NULL; link = &(*link)->next){
+        binding = *link;
+        if(SymTable_matches(binding, pcKey, uLength, uHash)){
+            SymTable_promote(chain, previousLink, link);
+            return binding;
         }
+        previousLink = link;
     }
-        
-    /* Change existing buckets array to new bucket array and get rid of
-    original buckets array by freeing it from memory. Then return 1 to 
-    indicate that expansion is possible. */
-    free(oSymTable->buckets);
-    oSymTable->buckets = newBuckets;
-    oSymTable->numBuckets = newNumBuckets;
+    return NULL;
 }
 
 int SymTable_put(SymTable_T oSymTable,
      const char *pcKey, const void *pvValue){
+    assert(pcKey!=NULL);
+    return SymTable_putn(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+/* Find the binding in oSymTable whose key is the uLength characters at
+pcKey, whose hash code is uHash, adding it with value pvValue if there 
+is none, with a single walk of its chain. Set *ppoBinding to the 
+binding, and return 1 if it was added, 0 if it was already present, or 
+-1 if it had to be added but not enough memory is available, in which 
+case oSymTable does not change. The caller holds the key's stripe, and 
+releases it with SymTable_unlockAndResize. */
+static int SymTable_insert(SymTable_T oSymTable, const char *pcKey,
+     size_t uLength, size_t uHash, const void *pvValue,
+     struct Binding **ppoBinding){
         struct Binding *thisBinding;
-        size_t bucket;
-        size_t maximum;
+        struct Binding **chain;
 
         assert(oSymTable!=NULL);
         assert(pcKey!=NULL);
 
+        SymTable_migrate(oSymTable);
+
+#ifndef SYMTABLE_CONCURRENT
         /* Expand hash table if number of bindings is greater
-        than number of buckets */
-        if(((oSymTable->length)>(oSymTable->numBuckets))){
-            /* Check to make sure that maximum has not been reached */
-            maximum = sizeof(primeBuckCounts)/sizeof(size_t);
-            if((oSymTable->numBuckets)<primeBuckCounts[maximum-1]){
-                (void)SymTable_expand(oSymTable);
-            }
+        than number of buckets, or if a small table is full, unless 
+        an expansion is still being carried out */
+        if(SymTable_isFull(oSymTable)){
+            (void)SymTable_expand(oSymTable);
         }
+#endif
 
-        bucket = SymTable_hash(pcKey, oSymTable->numBuckets);
+        chain = SymTable_chain(oSymTable, uHash);
 
         /* Non-expansion */
-        for(thisBinding = oSymTable->buckets[bucket];
+        for(thisBinding = *chain;
         thisBinding != NULL; thisBinding = thisBinding->next){
-            if(strcmp(pcKey, thisBinding->key)==0){
+            if(SymTable_matches(thisBinding, pcKey, uLength, uHash)){
+                *ppoBinding = thisBinding;
                 return 0;
             }                    
         }
 
-        /* Define newBinding */
-        thisBinding = (struct Binding*)malloc(sizeof(struct Binding));
+        /* Define newBinding, with room after it for the key: key 
+        length + 1 (for terminating null character). */
+        thisBinding = SymTable_allocBinding(oSymTable, uHash, 
+        uLength+1);
 
         /* If returns NULL, then this means insufficient memory 
         is available. Have to check here, since this is an issue
         of insufficient memory if NULL. */
         if(thisBinding==NULL){
-            return 0;
+            return -1;
         }
 
-        /* If these tests are passed, then attempt to assign a key 
-        to newBinding. Memory allocation size of key is string 
-        length + 1 (for terminating null character). */
-        thisBinding->key = (const char*)malloc(strlen(pcKey)+1);
+        /* Give instructions for return 1 case, since a binding
+        needs to be added. The key is copied, since the caller
+        keeps ownership of pcKey, and terminated, since pcKey 
+        need not be. */
+        memcpy(thisBinding->key, pcKey, uLength);
+        thisBinding->key[uLength] = '\0';
+        thisBinding->keyLength = uLength;
 
-        /* Not only need to return 0, but get rid of memory allocation 
-        for newBinding, since it does not satisfy the requirements. */
-        if(thisBinding->key==NULL){
-            free(thisBinding);
-            return 0;
+        thisBinding->value = pvValue;
+        thisBinding->hash = uHash;
+        thisBinding->next = *chain;
+        SymTable_store(chain, thisBinding);
+        SymTable_addLength(oSymTable, 1);
+        *ppoBinding = thisBinding;
+        return 1;            
+    }
+
+int SymTable_putn(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength, const void *pvValue){
+    struct Binding *binding;
+    size_t uHash;
+    int iResult;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uHash = (*oSymTable->pfHash)(pcKey, uLength);
+    Stripe_lock(SymTable_stripe(oSymTable, uHash));
+    iResult = SymTable_insert(oSymTable, pcKey, uLength, uHash, pvValue,
+        &binding);
+    SymTable_unlockAndResize(oSymTable, uHash);
+    return iResult==1;
+}
+
+int SymTable_getOrPut(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue, void **ppvValue){
+    struct Binding *binding;
+    size_t uLength;
+    size_t uHash;
+    int iResult;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uLength = strlen(pcKey);
+    uHash = (*oSymTable->pfHash)(pcKey, uLength);
+    Stripe_lock(SymTable_stripe(oSymTable, uHash));
+    iResult = SymTable_insert(oSymTable, pcKey, uLength, uHash, pvValue,
+        &binding);
+    if(iResult>=0 && ppvValue!=NULL){
+        *ppvValue = (void*)binding->value;
+    }
+    SymTable_unlockAndResize(oSymTable, uHash);
+    return iResult;
+}
+
+int SymTable_putOrReplace(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue, void **ppvOldValue){
+    struct Binding *binding;
+    size_t uLength;
+    size_t uHash;
+    int iResult;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uLength = strlen(pcKey);
+    uHash = (*oSymTable->pfHash)(pcKey, uLength);
+    Stripe_lock(SymTable_stripe(oSymTable, uHash));
+    iResult = SymTable_insert(oSymTable, pcKey, uLength, uHash, pvValue,
+        &binding);
+
+    /* An existing binding is updated in place. */
+    if(iResult==0){
+        if(ppvOldValue!=NULL){
+            *ppvOldValue = (void*)binding->value;
         }
+        SymTable_store(&binding->value, pvValue);
+    }
+    SymTable_unlockAndResize(oSymTable, uHash);
+    return iResult;
+}
 
-        /* Give instructions for return 1 case, since a binding
-        needs to be added. */
+size_t SymTable_putBatch(SymTable_T oSymTable,
+     const char *const apcKeys[], const void *const apvValues[],
+     size_t uCount, int aiResults[]){
+#ifndef SYMTABLE_CONCURRENT
+    size_t uBytes;
+    size_t uSize;
+#endif
+    size_t uLength;
+    size_t uAdded;
+    size_t i;
+    int iSuccessful;
+
+    assert(oSymTable!=NULL);
+    assert(apcKeys!=NULL || uCount==0);
+    assert(apvValues!=NULL || uCount==0);
 
-        /* For key portion, need to use strcpy instead of 
-        assignment operator, since pointer reference will not 
-        actually result in new key. Need (char*) cast since 
-        newBinding->key is const char by definition. */
-        strcpy((char*)thisBinding->key, pcKey);
+    /* Grow once, to the size the table would have if every key were
+    new, so that none of the puts below expands it. Should that fail,
+    the puts still work, expanding as usual. */
+    uLength = SymTable_loadLength(oSymTable);
+    if(uCount <= ((size_t)-1) - uLength){
+        (void)SymTable_reserve(oSymTable, uLength + uCount);
+    }
 
+#ifndef SYMTABLE_CONCURRENT
+    /* Take the memory for all of the small bindings from a single
+    chunk. Large bindings get chunks of their own as always. In the 
+    concurrent build, bindings come from the arenas of many stripes, 
+    and each is allocated on its own. */
+    uBytes = 0;
+    for(i = 0; i < uCount; i++){
+        assert(apcKeys[i]!=NULL);
+        uSize = Arena_bindingSize(strlen(apcKeys[i])+1);
+        if(uSize <= ARENA_MAX_SMALL){
+            uBytes += uSize;
+        }
+    }
+    (void)Arena_reserve(&SymTable_stripe(oSymTable, 0)->arena, uBytes);
+#endif
 
-        thisBinding->value = pvValue;
-        thisBinding->next = (oSymTable->buckets)[bucket];
-        (oSymTable->buckets)[bucket]=thisBinding;
-        oSymTable->length+=1;
-        return 1;            
+    uAdded = 0;
+    for(i = 0; i < uCount; i++){
+        iSuccessful = SymTable_put(oSymTable, apcKeys[i], apvValues[i]);
+        if(aiResults!=NULL){
+            aiResults[i] = iSuccessful;
+        }
+        if(iSuccessful){
+            uAdded += 1;
+        }
     }
+    return uAdded;
+}
 
-        
 void *SymTable_replace(SymTable_T oSymTable,
      const char *pcKey, const void *pvValue){
+    assert(pcKey!=NULL);
+    return SymTable_replacen(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+void *SymTable_replacen(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength, const void *pvValue){
         struct Binding *binding;
-        const void *oldValue;
-        size_t bucket;
+        const void *oldValue = NULL;
+        size_t uHash;
 
         assert(oSymTable!=NULL);
         assert(pcKey!=NULL);
 
-        bucket = SymTable_hash(pcKey, oSymTable->numBuckets);
-
-        for(binding = oSymTable->buckets[bucket]; 
-        binding != NULL; binding = binding->next){
-            if(strcmp(pcKey, binding->key)==0){
-                break;
-            }        
-        }
-
-        if(binding==NULL){
-            return NULL;
+        uHash = (*oSymTable->pfHash)(pcKey, uLength);
+        Stripe_lock(SymTable_stripe(oSymTable, uHash));
+        binding = SymTable_lookup(oSymTable, pcKey, uLength, uHash);
+        if(binding!=NULL){
+            oldValue = binding->value;
+            SymTable_store(&binding->value, pvValue);
         }
-
-        oldValue = binding->value;
-        binding->value = pvValue;
+        Stripe_unlock(SymTable_stripe(oSymTable, uHash));
 
         return (void*)oldValue;
     }
 
-int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+#ifdef SYMTABLE_RCU
+/* Set *ppvValue to the value of the binding in oSymTable whose key is 
+the uLength characters at pcKey, whose hash code is uHash, and return 
+1 (for true), or return 0 (for false) if there is no such binding. No 
+lock is taken. The walk is tried again if a resize overlaps it. */
+static int SymTable_read(SymTable_T oSymTable, const char *pcKey,
+     size_t uLength, size_t uHash, const void **ppvValue){
+    struct ReaderSlot *slot;
+    unsigned int parity;
+    size_t resizeCount;
+    struct Binding **buckets;
+    size_t numBuckets;
     struct Binding *binding;
-    size_t bucket;
+    const void *value;
 
-    assert(oSymTable!=NULL);
-    assert(pcKey!=NULL);
+    slot = SymTable_readBegin(oSymTable, &parity);
+    for(;;){
+        resizeCount = __atomic_load_n(&oSymTable->resizeCount,
+        __ATOMIC_ACQUIRE);
+        if(resizeCount % 2 == 0){
+            buckets = SymTable_load(&oSymTable->buckets);
+            numBuckets = SymTable_load(&oSymTable->numBuckets);
 
-    bucket = SymTable_hash(pcKey, oSymTable->numBuckets);
+            /* The array and its size must belong together before the 
+            array is indexed. */
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if(__atomic_load_n(&oSymTable->resizeCount, 
+                __ATOMIC_RELAXED)==resizeCount){
+                binding = SymTable_scan(SymTable_load(
+                    &buckets[SymTable_bucket(uHash, numBuckets)]),
+                    pcKey, uLength, uHash);
+                value = binding==NULL 
+                    ? NULL : SymTable_load(&binding->value);
 
-    for(binding = (oSymTable->buckets)[bucket]; binding != NULL; 
-    binding = binding->next){
-        /* If any binding matches, return 1. */
-        if(strcmp(pcKey, binding->key)==0){
-            return 1;
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if(__atomic_load_n(&oSymTable->resizeCount, 
+                    __ATOMIC_RELAXED)==resizeCount){
+                    break;
+                }
+            }
         }
+        (void)sched_yield();
     }
-    /* Return 0 otherwise. */
-    return 0;
+    SymTable_readEnd(slot, parity);
+
+    *ppvValue = value;
+    return binding!=NULL;
+}
+#endif
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    assert(pcKey!=NULL);
+    return SymTable_containsn(oSymTable, pcKey, strlen(pcKey));
+}
+
+int SymTable_containsn(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength){
+#ifdef SYMTABLE_RCU
+    const void *value;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    return SymTable_read(oSymTable, pcKey, uLength, 
+        (*oSymTable->pfHash)(pcKey, uLength), &value);
+#else
+    return SymTable_findn(oSymTable, pcKey, uLength)!=NULL;
+#endif
 }
 
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    assert(pcKey!=NULL);
+    return SymTable_getn(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_getn(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength){
+#ifndef SYMTABLE_RCU
     struct Binding *binding;
-    size_t bucket;
+#endif
+    const void *value = NULL;
+    size_t uHash;
 
     assert(oSymTable!=NULL);
     assert(pcKey!=NULL);
 
-    bucket = SymTable_hash(pcKey, oSymTable->numBuckets);
+    uHash = (*oSymTable->pfHash)(pcKey, uLength);
+#ifdef SYMTABLE_RCU
+    (void)SymTable_read(oSymTable, pcKey, uLength, uHash, &value);
+#else
+    Stripe_lock(SymTable_stripe(oSymTable, uHash));
+    binding = SymTable_lookup(oSymTable, pcKey, uLength, uHash);
+    if(binding!=NULL){
+        value = binding->value;
+    }
+    Stripe_unlock(SymTable_stripe(oSymTable, uHash));
+#endif
+    return (void*)value;
+}
+
+#ifdef SYMTABLE_CONCURRENT
+/* The chains of a group of keys belong to many stripes, which cannot
+all be held at once without stalling every other thread, so in the 
+concurrent build each key is looked up on its own. */
+void SymTable_getBatch(SymTable_T oSymTable,
+     const char *const apcKeys[], size_t uCount, void *apvValues[]){
+#ifdef SYMTABLE_RCU
+    const void *value;
+#else
+    struct Binding *binding;
+#endif
+    size_t uLength;
+    size_t uHash;
+    size_t i;
+
+    assert(oSymTable!=NULL);
+    assert(apcKeys!=NULL || uCount==0);
+    assert(apvValues!=NULL || uCount==0);
+
+    for(i = 0; i < uCount; i++){
+        assert(apcKeys[i]!=NULL);
+        uLength = strlen(apcKeys[i]);
+        uHash = (*oSymTable->pfHash)(apcKeys[i], uLength);
+#ifdef SYMTABLE_RCU
+        (void)SymTable_read(oSymTable, apcKeys[i], uLength, uHash, 
+            &value);
+        apvValues[i] = (void*)value;
+#else
+        Stripe_lock(SymTable_stripe(oSymTable, uHash));
+        binding = SymTable_scan(*SymTable_chain(oSymTable, uHash),
+            apcKeys[i], uLength, uHash);
+        apvValues[i] = binding==NULL ? NULL : (void*)binding->value;
+        Stripe_unlock(SymTable_stripe(oSymTable, uHash));
+#endif
+    }
+}
+#else
+void SymTable_getBatch(SymTable_T oSymTable,
+     const char *const apcKeys[], size_t uCount, void *apvValues[]){
+    size_t auLengths[BATCH_GROUP];
+    size_t auHashes[BATCH_GROUP];
+    struct Binding **apChains[BATCH_GROUP];
+    struct Binding *apHeads[BATCH_GROUP];
+    size_t first;
+    size_t groupSize;
+    size_t i;
+
+    assert(oSymTable!=NULL);
+    assert(apcKeys!=NULL || uCount==0);
+    assert(apvValues!=NULL || uCount==0);
+
+    for(first = 0; first < uCount; first += groupSize){
+        groupSize = uCount - first;
+        if(groupSize > BATCH_GROUP){
+            groupSize = BATCH_GROUP;
+        }
+
+        /* Pass 1: hash every key, and start reading its bucket. */
+        for(i = 0; i < groupSize; i++){
+            assert(apcKeys[first+i]!=NULL);
+            auLengths[i] = strlen(apcKeys[first+i]);
+            auHashes[i] = (*oSymTable->pfHash)(apcKeys[first+i],
+                auLengths[i]);
+            apChains[i] = SymTable_chain(oSymTable, auHashes[i]);
+            SymTable_prefetch(apChains[i]);
+        }
+
+        /* Pass 2: by now the first buckets have arrived; start 
+        reading the first binding of every chain. */
+        for(i = 0; i < groupSize; i++){
+            apHeads[i] = *apChains[i];
+            if(apHeads[i]!=NULL){
+                SymTable_prefetch(apHeads[i]);
+            }
+        }
 
-    for(binding = (oSymTable->buckets)[bucket]; 
-    binding != NULL; binding = binding->next){
-        if(strcmp(pcKey, binding->key)==0){
-            return (void*)binding->value;
+        /* Pass 3: walk the chains, whose heads should be cached. */
+        for(i = 0; i < groupSize; i++){
+            apHeads[i] = SymTable_scan(apHeads[i], apcKeys[first+i],
+                auLengths[i], auHashes[i]);
+            apvValues[first+i] = apHeads[i]==NULL
+                ? NULL : (void*)apHeads[i]->value;
         }
     }
-    return NULL;
+}
+#endif
+
+/* Remove the binding *link points to from its chain in oSymTable, 
+free it, and return its value. The table shrinks if it has become 
+sparse. The caller holds the binding's stripe, and releases it with
+SymTable_unlockAndResize. */
+static void *SymTable_unlink(SymTable_T oSymTable,
+     struct Binding **link){
+    struct Binding *thisBinding = *link;
+    const void *removedValue;
+
+    SymTable_store(link, thisBinding->next);
+    SymTable_addLength(oSymTable, -1);
+    removedValue = thisBinding->value;
+
+    /* Free binding, key included, and return removedValue */
+    SymTable_releaseBinding(oSymTable, thisBinding);
+
+#ifndef SYMTABLE_CONCURRENT
+    /* Shrink hash table if it has become sparse, unless a
+    resize is still being carried out */
+    if(SymTable_isSparse(oSymTable)){
+        (void)SymTable_resize(oSymTable, 
+        oSymTable->numBuckets/2);
+    }
+#endif
+    return (void*)removedValue;
 }
 
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    assert(pcKey!=NULL);
+    return SymTable_removen(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_removen(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength){
     /* Need to know binding before the current one, if it exists. */
     struct Binding *previousBinding;
     struct Binding *thisBinding;
-    const void *removedValue;
-    size_t bucket;
+    struct Binding **chain;
+    void *removedValue = NULL;
+    size_t uHash;
 
     assert(oSymTable!=NULL);
     assert(pcKey!=NULL);
 
-    bucket = SymTable_hash(pcKey, oSymTable->numBuckets);
+    uHash = (*oSymTable->pfHash)(pcKey, uLength);
+    Stripe_lock(SymTable_stripe(oSymTable, uHash));
+    SymTable_migrate(oSymTable);
+    chain = SymTable_chain(oSymTable, uHash);
 
     /* Want to start at beginning, so previousBinding is NULL. */
     previousBinding=NULL;
 
-    for(thisBinding = (oSymTable->buckets)[bucket]; 
+    for(thisBinding = *chain; 
     thisBinding != NULL; thisBinding = thisBinding->next){
-        if(strcmp(pcKey, thisBinding->key)==0){
+        if(SymTable_matches(thisBinding, pcKey, uLength, uHash)){
             /* Case 1: previousBinding is NULL, so thisBinding 
             is first. */
             if(previousBinding==NULL){
-                oSymTable->buckets[bucket]=thisBinding->next;
+                removedValue = SymTable_unlink(oSymTable, chain);
             }
             /* Case 2: previousBinding is not NULL */
             else{
-                previousBinding->next = thisBinding->next;
+                removedValue = SymTable_unlink(oSymTable, 
+                &previousBinding->next);
             }
+            break;
+        }
+        previousBinding=thisBinding;
+    }
+    SymTable_unlockAndResize(oSymTable, uHash);
+    return removedValue;
+}
+
+SymTable_Binding_T SymTable_find(SymTable_T oSymTable,
+     const char *pcKey){
+    assert(pcKey!=NULL);
+    return SymTable_findn(oSymTable, pcKey, strlen(pcKey));
+}
+
+SymTable_Binding_T SymTable_findn(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength){
+    struct Binding *binding;
+    size_t uHash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uHash = (*oSymTable->pfHash)(pcKey, uLength);
+    Stripe_lock(SymTable_stripe(oSymTable, uHash));
+    binding = SymTable_lookup(oSymTable, pcKey, uLength, uHash);
+    Stripe_unlock(SymTable_stripe(oSymTable, uHash));
+    return binding;
+}
+
+const char *SymTable_keyAt(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding){
+    assert(oSymTable!=NULL);
+    assert(oBinding!=NULL);
+
+    return oBinding->key;
+}
+
+void *SymTable_getAt(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding){
+    const void *value;
+
+    assert(oSymTable!=NULL);
+    assert(oBinding!=NULL);
+
+    Stripe_lock(SymTable_stripe(oSymTable, oBinding->hash));
+    value = oBinding->value;
+    Stripe_unlock(SymTable_stripe(oSymTable, oBinding->hash));
+    return (void*)value;
+}
+
+void *SymTable_replaceAt(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding, const void *pvValue){
+    const void *oldValue;
+
+    assert(oSymTable!=NULL);
+    assert(oBinding!=NULL);
 
-            oSymTable->length-=1;
+    Stripe_lock(SymTable_stripe(oSymTable, oBinding->hash));
+    oldValue = oBinding->value;
+    SymTable_store(&oBinding->value, pvValue);
+    Stripe_unlock(SymTable_stripe(oSymTable, oBinding->hash));
+    return (void*)oldValue;
+}
+
+void *SymTable_removeAt(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding){
+    struct Binding **link;
+    size_t uHash;
+    void *removedValue;
+
+    assert(oSymTable!=NULL);
+    assert(oBinding!=NULL);
 
-            /* Free key */
-            free((char*)thisBinding->key);
-            removedValue = thisBinding->value;
+    /* Bindings never move in memory, but migration may move one to 
+    another chain, so the chain is found only afterwards. The binding 
+    is then found by address, without comparing keys. Its hash code 
+    is read first, since the binding is freed before the stripe is 
+    released. */
+    uHash = oBinding->hash;
+    Stripe_lock(SymTable_stripe(oSymTable, uHash));
+    SymTable_migrate(oSymTable);
+    for(link = SymTable_chain(oSymTable, uHash);
+    *link != oBinding; link = &(*link)->next){
+        assert(*link!=NULL);
+    }
+    removedValue = SymTable_unlink(oSymTable, link);
+    SymTable_unlockAndResize(oSymTable, uHash);
+    return removedValue;
+}
 
-            /* Then, free binding and return removedValue */
-            free(thisBinding);
-            return (void*)removedValue;
+/* Return the first binding of oSymTable in bucket uBucket or a later 
+one, in the order SymTable_map visits buckets, or NULL if there is 
+none. The bucket is one of the old buckets if iOld is 1 (for true), 
+and one of the current ones otherwise. */
+static struct Binding *SymTable_firstFrom(SymTable_T oSymTable,
+     int iOld, size_t uBucket){
+    if(!iOld){
+        for(; uBucket<oSymTable->numBuckets; uBucket++){
+            if((oSymTable->buckets)[uBucket]!=NULL){
+                return (oSymTable->buckets)[uBucket];
+            }
+        }
+        /* Old buckets that have already been moved are empty. */
+        uBucket = oSymTable->migrateIndex;
+    }
+    for(; uBucket<oSymTable->numOldBuckets; uBucket++){
+        if((oSymTable->oldBuckets)[uBucket]!=NULL){
+            return (oSymTable->oldBuckets)[uBucket];
         }
-        previousBinding=thisBinding;
     }
     return NULL;
 }
 
-void SymTable_map(SymTable_T oSymTable,
+SymTable_Binding_T SymTable_iterBegin(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+
+    if(SymTable_loadLength(oSymTable)==0){
+        return NULL;
+    }
+    return SymTable_firstFrom(oSymTable, 0, 0);
+}
+
+SymTable_Binding_T SymTable_iterNext(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding){
+    size_t bucket;
+
+    assert(oSymTable!=NULL);
+    assert(oBinding!=NULL);
+
+    if(oBinding->next!=NULL){
+        return oBinding->next;
+    }
+
+    /* The chain is used up, so continue from the bucket after the one 
+    it hangs from, found from the cached hash as SymTable_chain finds 
+    it. */
+    if(oSymTable->oldBuckets!=NULL){
+        bucket = SymTable_bucket(oBinding->hash, 
+        oSymTable->numOldBuckets);
+        if(bucket>=oSymTable->migrateIndex){
+            return SymTable_firstFrom(oSymTable, 1, bucket+1);
+        }
+    }
+    bucket = SymTable_bucket(oBinding->hash, oSymTable->numBuckets);
+    return SymTable_firstFrom(oSymTable, 0, bucket+1);
+}
+
+SymTable_Binding_T SymTable_iterEnd(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+
+    return NULL;
+}
+
+/* Apply function *pfApply to each binding of oSymTable in buckets 
+uFirst to uStop-1, passing pvExtra as an extra parameter. Buckets are 
+numbered as SymTable_map visits them: the current buckets first, then 
+the old ones. */
+static void SymTable_mapBuckets(SymTable_T oSymTable,
+     size_t uFirst, size_t uStop,
      void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
-     const void *pvExtra){
+     void *pvExtra){
         struct Binding *binding;
         size_t bucketNumber;
 
-        assert(oSymTable!=NULL);
-        assert(pfApply!=NULL);
-        
-        for(bucketNumber=0; bucketNumber<(oSymTable->numBuckets); 
-        bucketNumber++){
+        for(bucketNumber=uFirst; bucketNumber<uStop 
+        && bucketNumber<oSymTable->numBuckets; bucketNumber++){
             for(binding = (oSymTable->buckets)[bucketNumber]; 
             binding != NULL; binding = binding->next){
-                (*pfApply)((char*)binding->key,(void*)binding->value, 
-                (void*)pvExtra);
+                (*pfApply)(binding->key,(void*)binding->value, pvExtra);
+            }
+        }
+
+        /* Old buckets that have already been moved are empty. */
+        for(; bucketNumber<uStop; bucketNumber++){
+            for(binding = (oSymTable->oldBuckets)
+            [bucketNumber - oSymTable->numBuckets]; 
+            binding != NULL; binding = binding->next){
+                (*pfApply)(binding->key,(void*)binding->value, pvExtra);
             }
         }
      }
+
+void SymTable_map(SymTable_T oSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra){
+        assert(oSymTable!=NULL);
+        assert(pfApply!=NULL);
+
+        SymTable_lockAll(oSymTable);
+        SymTable_mapBuckets(oSymTable, 0, 
+        oSymTable->numBuckets + oSymTable->numOldBuckets, pfApply, 
+        (void*)pvExtra);
+        SymTable_unlockAll(oSymTable);
+     }
+
+/* The share of a SymTable_mapParallel call that one thread does. */
+struct MapRange {
+    /* The table being walked */
+    SymTable_T oSymTable;
+
+    /* First bucket of the range, numbered as in SymTable_mapBuckets */
+    size_t first;
+
+    /* Bucket after the last one of the range */
+    size_t stop;
+
+    /* The function applied to each binding */
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+
+    /* The extra parameter passed to pfApply */
+    void *pvExtra;
+
+    /* The thread walking the range, if started is 1 */
+    pthread_t thread;
+
+    /* 1 (for true) if a thread of its own walks the range, or 0 (for
+    false) if the calling thread does */
+    int started;
+};
+
+/* Return the first of uTotal buckets that range uRange of uCount 
+ranges holds. Each range gets uTotal/uCount buckets, and the first 
+uTotal%uCount ranges one more. */
+static size_t SymTable_rangeStart(size_t uTotal, size_t uCount,
+     size_t uRange){
+    size_t extra = uTotal % uCount;
+
+    return uRange * (uTotal / uCount) + (uRange < extra ? uRange : extra);
+}
+
+/* Walk the MapRange that pvRange points to. Return NULL. This is the 
+start routine of each thread SymTable_mapParallel starts. */
+static void *MapRange_run(void *pvRange){
+    struct MapRange *range = (struct MapRange*)pvRange;
+
+    SymTable_mapBuckets(range->oSymTable, range->first, range->stop,
+    range->pfApply, range->pvExtra);
+    return NULL;
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable, size_t uThreadCount,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     void *const apvExtras[],
+     void (*pfReduce)(void *pvResult, void *pvExtra), void *pvResult){
+    struct MapRange *ranges;
+    size_t total;
+    size_t i;
+
+    assert(oSymTable!=NULL);
+    assert(uThreadCount>0);
+    assert(pfApply!=NULL);
+    assert(apvExtras!=NULL);
+
+    /* The worker threads take no locks of their own; the calling 
+    thread holds every stripe for them until they are done. */
+    SymTable_lockAll(oSymTable);
+    total = oSymTable->numBuckets + oSymTable->numOldBuckets;
+    ranges = (struct MapRange*)calloc(uThreadCount, 
+    sizeof(struct MapRange));
+
+    if(ranges==NULL){
+        /* Not enough memory to keep track of threads, so the calling 
+        thread walks each range in turn. */
+        for(i = 0; i < uThreadCount; i++){
+            SymTable_mapBuckets(oSymTable, 
+            SymTable_rangeStart(total, uThreadCount, i),
+            SymTable_rangeStart(total, uThreadCount, i+1),
+            pfApply, apvExtras[i]);
+        }
+    }
+    else{
+        for(i = 0; i < uThreadCount; i++){
+            ranges[i].oSymTable = oSymTable;
+            ranges[i].first = SymTable_rangeStart(total, uThreadCount, i);
+            ranges[i].stop = SymTable_rangeStart(total, uThreadCount, 
+            i+1);
+            ranges[i].pfApply = pfApply;
+            ranges[i].pvExtra = apvExtras[i];
+
+            /* The calling thread walks the first range itself, and 
+            any range for which no thread can be started. The others 
+            get threads of their own for this call only; see 
+            symtablehash.h. */
+            if(i > 0 && total / uThreadCount >= PARALLEL_MIN_BUCKETS){
+                ranges[i].started = pthread_create(&ranges[i].thread, 
+                NULL, MapRange_run, &ranges[i])==0;
+            }
+        }
+        for(i = 0; i < uThreadCount; i++){
+            if(!ranges[i].started){
+                (void)MapRange_run(&ranges[i]);
+            }
+        }
+        for(i = 0; i < uThreadCount; i++){
+            if(ranges[i].started){
+                (void)pthread_join(ranges[i].thread, NULL);
+            }
+        }
+        free(ranges);
+    }
+    SymTable_unlockAll(oSymTable);
+
+    if(pfReduce!=NULL){
+        for(i = 0; i < uThreadCount; i++){
+            (*pfReduce)(pvResult, apvExtras[i]);
+        }
+    }
+}
+
@@ -0,0 +1,185 @@
+/* symtablehash.h */
+/* Author: Vikram Kakaria */
+
+#ifndef SYMTABLEHASH_H
+#define SYMTABLEHASH_H
+
+#include "symtable.h"
+
+/* The functions below extend the SymTable interface, and are provided
+only by the hash table implementation (symtablehash.c). */
+
+/* SymTable_Binding_T is a handle to one binding of a SymTable, through
+which the binding can be read, changed or removed again without its 
+key being hashed or compared. A handle stays valid, even as the table 
+grows and shrinks, until its binding is removed or its table freed. */
+typedef struct Binding *SymTable_Binding_T;
+
+/* The hash functions a SymTable can place its keys with. */
+typedef enum SymTable_HashPolicy {
+    /* The hash function from the assignment specification, which 
+    consumes one character per step. It is the default, and the one 
+    testCollisions in testsymtable.c assumes. */
+    SYMTABLE_HASH_CLASSIC,
+
+    /* A hash function that consumes 8 bytes per step and mixes them 
+    thoroughly. It is much faster on long keys, and spreads keys that 
+    share long prefixes better. */
+    SYMTABLE_HASH_WIDE
+} SymTable_HashPolicy_T;
+
+/* Returns a new SymTable object without bindings, sized so that 
+uCapacity bindings can be added without the table expanding, or, if 
+not enough memory is available, return NULL. */
+SymTable_T SymTable_newWithCapacity(size_t uCapacity);
+
+/* Make room in oSymTable for a total of uCapacity bindings, so that 
+adding bindings up to that count does not make the table expand. 
+Return 1 (for true) on success, or 0 (for false) if not enough memory 
+is available, in which case oSymTable does not change. The table may 
+still shrink again as bindings are removed. */
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity);
+
+/* Returns a new SymTable object without bindings that hashes its keys 
+with the function ePolicy names, sized as SymTable_newWithCapacity 
+would size it for uCapacity bindings, or, if not enough memory is 
+available, return NULL. */
+SymTable_T SymTable_newWithHash(SymTable_HashPolicy_T ePolicy,
+     size_t uCapacity);
+
+/* Reduce the number of buckets in oSymTable to the smallest power of 
+two that is at least its number of bindings, finishing any resize that 
+is under way first. If not enough memory is available, oSymTable keeps 
+its current buckets. Tables also shrink gradually by themselves as 
+bindings are removed; this function does so at once. */
+void SymTable_shrinkToFit(SymTable_T oSymTable);
+
+/* The functions below behave like SymTable_put, SymTable_replace, 
+SymTable_contains, SymTable_get and SymTable_remove, but take the key 
+as the uLength characters at pcKey instead of as a string. The key 
+need not be null-terminated, so a slice of a larger buffer may be 
+passed without being copied, but it must not itself contain a null 
+character. The key stored by SymTable_putn is a null-terminated copy, 
+which is what SymTable_map passes to its function. */
+int SymTable_putn(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength, const void *pvValue);
+void *SymTable_replacen(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength, const void *pvValue);
+int SymTable_containsn(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength);
+void *SymTable_getn(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength);
+void *SymTable_removen(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength);
+
+/* If oSymTable has a binding whose key is pcKey, return 0 (for 
+false), set *ppvValue to its value and leave it alone. If not, add a 
+binding with key pcKey and value pvValue, set *ppvValue to pvValue and 
+return 1 (for true). If not enough memory is available to add it, 
+return -1 and do not change oSymTable or *ppvValue. ppvValue may be 
+NULL. The key is hashed, and its chain walked, only once. */
+int SymTable_getOrPut(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue, void **ppvValue);
+
+/* If oSymTable has a binding whose key is pcKey, replace its value 
+with pvValue, set *ppvOldValue to the old value and return 0 (for 
+false). If not, add a binding with key pcKey and value pvValue and 
+return 1 (for true), leaving *ppvOldValue alone. If not enough memory 
+is available to add it, return -1 and do not change oSymTable. 
+ppvOldValue may be NULL. The key is hashed, and its chain walked, only 
+once. */
+int SymTable_putOrReplace(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue, void **ppvOldValue);
+
+/* Return a handle to the binding in oSymTable whose key is pcKey, or 
+NULL if there is no such binding. SymTable_findn takes the key as the 
+uLength characters at pcKey, as SymTable_getn does. */
+SymTable_Binding_T SymTable_find(SymTable_T oSymTable,
+     const char *pcKey);
+SymTable_Binding_T SymTable_findn(SymTable_T oSymTable,
+     const char *pcKey, size_t uLength);
+
+/* Return the key of oBinding, a binding of oSymTable. The key belongs 
+to oSymTable and must not be changed. */
+const char *SymTable_keyAt(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding);
+
+/* Return the value of oBinding, a binding of oSymTable. */
+void *SymTable_getAt(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding);
+
+/* Replace the value of oBinding, a binding of oSymTable, with pvValue,
+and return the old value. */
+void *SymTable_replaceAt(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding, const void *pvValue);
+
+/* Remove oBinding, a binding of oSymTable, and return its value. 
+oBinding is no longer valid afterwards. */
+void *SymTable_removeAt(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding);
+
+/* Put the uCount bindings apcKeys[i]/apvValues[i] into oSymTable, in
+order, as SymTable_put would. If aiResults is not NULL, set 
+aiResults[i] to the result of the put of apcKeys[i], which is 0 if the 
+key was already present, including earlier in the same batch. Return 
+the number of bindings added. The table grows at most once, to fit all 
+of the bindings, and their memory is allocated together; the table may 
+therefore end up with more buckets than it needs if many keys were 
+already present. */
+size_t SymTable_putBatch(SymTable_T oSymTable,
+     const char *const apcKeys[], const void *const apvValues[],
+     size_t uCount, int aiResults[]);
+
+/* Look up the uCount keys in apcKeys at once, and set apvValues[i] to 
+the value that SymTable_get(oSymTable, apcKeys[i]) would return. The 
+memory reads of many keys are overlapped, so this is faster than 
+calling SymTable_get for each key when the table does not fit in the 
+cache. apcKeys and apvValues must not overlap. */
+void SymTable_getBatch(SymTable_T oSymTable,
+     const char *const apcKeys[], size_t uCount, void *apvValues[]);
+
+/* The functions below walk the bindings of oSymTable one at a time, in
+the order SymTable_map visits them, so that a search can stop at the 
+first binding it wants:
+
+    for(oBinding = SymTable_iterBegin(oSymTable);
+        oBinding != SymTable_iterEnd(oSymTable);
+        oBinding = SymTable_iterNext(oSymTable, oBinding)){
+        ...
+    }
+
+SymTable_iterBegin returns the first binding, and SymTable_iterNext 
+the binding after oBinding; each returns SymTable_iterEnd(oSymTable) 
+if there is none. Bindings may be read and their values replaced 
+through SymTable_keyAt, SymTable_getAt and SymTable_replaceAt, but 
+oSymTable must not otherwise change until the walk is over. In builds 
+where lookups reorder chains (SYMTABLE_MOVE_TO_FRONT or 
+SYMTABLE_TRANSPOSE), it must not be searched either. */
+SymTable_Binding_T SymTable_iterBegin(SymTable_T oSymTable);
+SymTable_Binding_T SymTable_iterNext(SymTable_T oSymTable,
+     SymTable_Binding_T oBinding);
+SymTable_Binding_T SymTable_iterEnd(SymTable_T oSymTable);
+
+/* Apply function *pfApply to each binding in oSymTable, as SymTable_map 
+does, but with the buckets split into uThreadCount ranges, each walked 
+by a thread of its own. The thread walking range i passes apvExtras[i] 
+as the extra parameter, so that each can accumulate its results 
+without locking. Once every range has been walked, *pfReduce is called 
+in the calling thread with pvResult and each of apvExtras[0] to 
+apvExtras[uThreadCount-1] in turn, to combine them; pfReduce may be 
+NULL. Tables too small to gain from threads, and ranges for which no 
+thread can be started, are walked by the calling thread instead. 
+The threads are started for each call and joined before it returns, 
+rather than kept in a pool: starting one costs microseconds, against 
+milliseconds for a walk of the millions of bindings that are worth 
+splitting, and a pool would need state outlasting every table and a 
+call to shut it down. pfApply is called on different bindings at once, in no particular 
+order, and must not change oSymTable. The hash table implementation 
+uses POSIX threads, so programs that use it must be linked with 
+-pthread. */
+void SymTable_mapParallel(SymTable_T oSymTable, size_t uThreadCount,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     void *const apvExtras[],
+     void (*pfReduce)(void *pvResult, void *pvExtra), void *pvResult);
+
+#endif
@@ -9,18 +9,30 @@
 
 /* A binding has a key and a value. In this linked list version, 
 it can be seen as one binding linked to another within a linked 
-list. */
+list. The key's characters are stored at the end of the binding 
+itself, so each binding is a single allocation. */
 struct Binding {
-    /* Binding key */
-    const char *key; 
+    /* Next binding memory address */
+    struct Binding *next;
 
     /* Binding value */
     const void *value;
 
-    /* Next binding memory address */
-    struct Binding *next;
+    /* Binding key, including its terminating null character */
+    char key[];
 };
 
+/* Lists may be built to be self-organizing, so that keys looked up 
+often drift toward the head of the list and are found sooner. If 
+SYMTABLE_MOVE_TO_FRONT is defined, a binding that SymTable_get, 
+SymTable_contains or SymTable_replace finds is moved to the head of the 
+list. If SYMTABLE_TRANSPOSE is defined instead, it is swapped with the 
+binding before it, which adapts more slowly but is not thrown off by 
+keys that are looked up only once. */
+#if defined(SYMTABLE_MOVE_TO_FRONT) && defined(SYMTABLE_TRANSPOSE)
+#error "Define at most one of SYMTABLE_MOVE_TO_FRONT and SYMTABLE_TRANSPOSE"
+#endif
+
 /* A SymTable (indicating a symbol table) consists of bindings 
 that are linked together. Just as in a linked list, the pointer
 to the first binding is noted, along with the table's length. */
@@ -63,7 +75,6 @@ void SymTable_free(SymTable_T oSymTable){
     for(thisBinding = oSymTable->firstBinding; thisBinding != NULL; 
     thisBinding = nextBinding){
         nextBinding = thisBinding->next;
-        free((char*)thisBinding->key);
         free(thisBinding);
     }
     free(oSymTable);
@@ -74,10 +85,60 @@ size_t SymTable_getLength(SymTable_T oSymTable){
     return oSymTable->length;
 }
 
+/* Move the binding *link points to toward the head of the list 
+*head, as the self-organizing mode chosen above requires. previousLink 
+points to the link to the binding before it, or is NULL if it is the 
+first. */
+static void SymTable_promote(struct Binding **head,
+     struct Binding **previousLink, struct Binding **link){
+    struct Binding *binding = *link;
+
+#if defined(SYMTABLE_MOVE_TO_FRONT)
+    (void)previousLink;
+    *link = binding->next;
+    binding->next = *head;
+    *head = binding;
+#elif defined(SYMTABLE_TRANSPOSE)
+    (void)head;
+    if(previousLink!=NULL){
+        *link = binding->next;
+        binding->next = *previousLink;
+        *previousLink = binding;
+    }
+#else
+    (void)head;
+    (void)previousLink;
+    (void)binding;
+#endif
+}
+
+/* Return the binding in oSymTable whose key is pcKey, or NULL if there
+is no such binding. The binding found is promoted first. */
+static struct Binding *SymTable_lookup(SymTable_T oSymTable,
+     const char *pcKey){
+    struct Binding **previousLink;
+    struct Binding **link;
+    struct Binding *binding;
+
+    previousLink = NULL;
+    for(link = &oSymTable->firstBinding; *link != NULL; 
+    link = &(*link)->next){
+        binding = *link;
+        if(strcmp(pcKey, binding->key)==0){
+            SymTable_promote(&oSymTable->firstBinding, previousLink,
+                link);
+            return binding;
+        }
+        previousLink = link;
+    }
+    return NULL;
+}
+
 int SymTable_put(SymTable_T oSymTable,
      const char *pcKey, const void *pvValue){
         struct Binding *thisBinding;
         struct Binding *newBinding;
+        size_t keySize;
 
         assert(oSymTable!=NULL);
         assert(pcKey!=NULL);
@@ -90,8 +151,11 @@ int SymTable_put(SymTable_T oSymTable,
             }                    
         }
         
-        /* Define newBinding */
-        newBinding = (struct Binding*)malloc(sizeof(struct Binding));
+        /* Define newBinding, with room after it for the key: string 
+        length + 1 (for terminating null character). */
+        keySize = strlen(pcKey)+1;
+        newBinding = (struct Binding*)malloc(
+            offsetof(struct Binding, key) + keySize);
 
         /* If returns NULL, then this means insufficient memory 
         is available. */
@@ -99,27 +163,11 @@ int SymTable_put(SymTable_T oSymTable,
             return 0;
         }
 
-        /* If these tests are passed, then attempt to assign a key 
-        to newBinding. Memory allocation size of key is string 
-        length + 1 (for terminating null character). */
-        newBinding->key = (const char*)malloc(strlen(pcKey)+1);
-
-        /* Not only need to return 0, but get rid of memory allocation 
-        for newBinding, since it does not satisfy the requirements. */
-        if(newBinding->key==NULL){
-            free(newBinding);
-            return 0;
-        }
-
         /* Give instructions for return 1 case, since a binding
         needs to be added. The binding is added to the head 
-        of the linked list. */
-
-        /* For key portion, need to use strcpy instead of 
-        assignment operator, since pointer reference will not 
-        actually result in new key. Need (char*) cast since 
-        newBinding->key is const char by definition. */
-        strcpy((char*)newBinding->key, pcKey);
+        of the linked list. The key is copied, since the caller 
+        keeps ownership of pcKey. */
+        memcpy(newBinding->key, pcKey, keySize);
 
         newBinding->value = pvValue;
         newBinding->next = oSymTable->firstBinding;
@@ -136,12 +184,7 @@ void *SymTable_replace(SymTable_T oSymTable,
         assert(oSymTable!=NULL);
         assert(pcKey!=NULL);
 
-        for(binding = oSymTable->firstBinding; binding != NULL; 
-        binding = binding->next){
-            if(strcmp(pcKey, binding->key)==0){
-                break;
-            }        
-        }
+        binding = SymTable_lookup(oSymTable, pcKey);
 
         /* Check binding upon exiting for loop. */
         if(binding==NULL){
@@ -157,20 +200,11 @@ void *SymTable_replace(SymTable_T oSymTable,
     }
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
-    struct Binding *binding;
-
     assert(oSymTable!=NULL);
     assert(pcKey!=NULL);
 
-    for(binding = oSymTable->firstBinding; binding != NULL; 
-    binding = binding->next){
-        /* If any binding matches, return 1. */
-        if(strcmp(pcKey, binding->key)==0){
-            return 1;
-        }
-    }
-    /* Return 0 otherwise. */
-    return 0;
+    /* If any binding matches, return 1, and return 0 otherwise. */
+    return SymTable_lookup(oSymTable, pcKey)!=NULL;
 }
 
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
@@ -179,13 +213,12 @@ void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
     assert(oSymTable!=NULL);
     assert(pcKey!=NULL);
     
-    for(binding = oSymTable->firstBinding; binding != NULL; 
-    binding = binding->next){
-        /* If any binding matches, return its value, using
-        (void*) to cast. */
-        if(strcmp(pcKey, binding->key)==0){
-            return (void*)binding->value;
-        }
+    binding = SymTable_lookup(oSymTable, pcKey);
+
+    /* If any binding matches, return its value, using
+    (void*) to cast. */
+    if(binding!=NULL){
+        return (void*)binding->value;
     }
     /* Return NULL otherwise. */
     return NULL;  
@@ -217,12 +250,9 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
             }
 
             oSymTable->length-=1;
-
-            /* Free key */
-            free((char*)thisBinding->key);
             removedValue = thisBinding->value;
 
-            /* Then, free binding and return removedValue */
+            /* Free binding, key included, and return removedValue */
             free(thisBinding);
             return (void*)removedValue;
         }
@@ -242,7 +272,7 @@ void SymTable_map(SymTable_T oSymTable,
         
         for(binding = oSymTable->firstBinding; binding != NULL; 
         binding = binding->next){
-            (*pfApply)((char*)binding->key,(void*)binding->value, 
+            (*pfApply)(binding->key,(void*)binding->value, 
             (void*)pvExtra);
         }
      }
@@ -0,0 +1,364 @@
+/* symtableopen.c */
+/* Author: Vikram Kakaria */
+
+#include "symtable.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <assert.h>
+
+/* Number of slots in a new SymTable. Must be a power of two. */
+#define INITIAL_SLOT_COUNT 512
+
+/* The table grows once more than MAX_LOAD_NUM/MAX_LOAD_DEN of its
+slots are occupied. Robin Hood displacement keeps probe sequences
+short even at this load. */
+#define MAX_LOAD_NUM 7
+#define MAX_LOAD_DEN 8
+
+/* Fibonacci hashing multiplier, used to spread the bits of a hash
+code over the top of the word before the home slot is taken from
+them. */
+#if SIZE_MAX > 0xFFFFFFFFUL
+#define HASH_SPREAD ((size_t)0x9E3779B97F4A7C15ULL)
+#else
+#define HASH_SPREAD ((size_t)0x9E3779B9UL)
+#endif
+
+/* A slot of the probe array. An empty slot has a NULL key. The full
+hash code of the key is kept so that comparisons and resizing
+rarely have to touch the key string itself. */
+struct Slot {
+    /* Slot key, or NULL if the slot is empty */
+    const char *key;
+
+    /* Slot value */
+    const void *value;
+
+    /* Full hash code of key */
+    size_t hash;
+};
+
+/* A SymTable (indicating a symbol table) is a single flat array of
+slots using open addressing. Every binding sits at or after its home
+slot, and bindings are kept ordered by their distance from home
+(Robin Hood hashing), so a lookup may stop as soon as it meets a
+binding that is closer to home than the key it is looking for. */
+struct SymTable {
+    /* The array of slots. */
+    struct Slot *slots;
+
+    /* Tells number of bindings present. */
+    size_t length;
+
+    /* Tells number of slots present (a power of two). */
+    size_t numSlots;
+
+    /* Number of bits to shift a spread hash code right by to get
+    a slot index. */
+    unsigned int hashShift;
+};
+
+/* Return a hash code for pcKey. */
+static size_t SymTable_hash(const char *pcKey)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+   return uHash;
+}
+
+/* Return the home slot of a key whose hash code is uHash. */
+static size_t SymTable_home(SymTable_T oSymTable, size_t uHash){
+    return (uHash * HASH_SPREAD) >> oSymTable->hashShift;
+}
+
+/* Return how far the binding in slot index sits from its home
+slot. */
+static size_t SymTable_distance(SymTable_T oSymTable, size_t index){
+    return (index - SymTable_home(oSymTable,
+        oSymTable->slots[index].hash)) & (oSymTable->numSlots - 1);
+}
+
+/* Return the value of hashShift for a table of uNumSlots slots. */
+static unsigned int SymTable_shiftFor(size_t uNumSlots){
+    unsigned int shift = (unsigned int)(sizeof(size_t) * CHAR_BIT);
+
+    while(uNumSlots > 1){
+        uNumSlots >>= 1;
+        shift -= 1;
+    }
+    return shift;
+}
+
+/* Return the index of the slot holding pcKey (whose hash code is
+uHash) in oSymTable, or numSlots if there is no such slot. */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+     size_t uHash){
+    size_t mask = oSymTable->numSlots - 1;
+    size_t index = SymTable_home(oSymTable, uHash);
+    size_t distance;
+    struct Slot *slot;
+
+    for(distance = 0; ; distance++){
+        slot = &oSymTable->slots[index];
+
+        /* An empty slot, or a binding that is nearer its home than
+        pcKey would be, means that pcKey is absent. */
+        if(slot->key==NULL
+            || SymTable_distance(oSymTable, index) < distance){
+            return oSymTable->numSlots;
+        }
+        if(slot->hash==uHash && strcmp(pcKey, slot->key)==0){
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+/* Place a binding with key pcKey, hash code uHash and value pvValue
+in oSymTable, which must not already contain pcKey and must have at
+least one empty slot. The key string is not copied. */
+static void SymTable_place(SymTable_T oSymTable, const char *pcKey,
+     size_t uHash, const void *pvValue){
+    size_t mask = oSymTable->numSlots - 1;
+    size_t index = SymTable_home(oSymTable, uHash);
+    size_t distance = 0;
+    size_t slotDistance;
+    struct Slot carried;
+    struct Slot swap;
+
+    carried.key = pcKey;
+    carried.value = pvValue;
+    carried.hash = uHash;
+
+    for(;;){
+        if(oSymTable->slots[index].key==NULL){
+            oSymTable->slots[index] = carried;
+            return;
+        }
+
+        /* Take the slot from a binding that is closer to its home
+        than the carried one, and carry that binding on instead. */
+        slotDistance = SymTable_distance(oSymTable, index);
+        if(slotDistance < distance){
+            swap = oSymTable->slots[index];
+            oSymTable->slots[index] = carried;
+            carried = swap;
+            distance = slotDistance;
+        }
+        index = (index + 1) & mask;
+        distance += 1;
+    }
+}
+
+SymTable_T SymTable_new(void){
+    SymTable_T oSymTable;
+
+    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+
+    /* Not enough memory */
+    if(oSymTable==NULL){
+        return NULL;
+    }
+
+    oSymTable->length=0;
+    oSymTable->numSlots=INITIAL_SLOT_COUNT;
+    oSymTable->hashShift=SymTable_shiftFor(INITIAL_SLOT_COUNT);
+
+    /* Calloc gives every slot a NULL key, marking it empty. */
+    oSymTable->slots=(struct Slot*)calloc(
+        oSymTable->numSlots, sizeof(struct Slot));
+
+    if(oSymTable->slots==NULL){
+        free(oSymTable);
+        return NULL;
+    }
+
+    return oSymTable;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+    size_t index;
+
+    assert(oSymTable!=NULL);
+
+    for(index=0; index<oSymTable->numSlots; index++){
+        free((char*)oSymTable->slots[index].key);
+    }
+    free(oSymTable->slots);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+    return oSymTable->length;
+}
+
+/* This function seeks to expand oSymTable by doubling the number of
+slots present. If not enough memory is available, then the table is
+unchanged. */
+static void SymTable_expand(SymTable_T oSymTable){
+    struct Slot *oldSlots = oSymTable->slots;
+    size_t oldNumSlots = oSymTable->numSlots;
+    struct Slot *newSlots;
+    size_t index;
+
+    /* No room left to double into */
+    if(oldNumSlots > ((size_t)-1) / 2 / sizeof(struct Slot)){
+        return;
+    }
+
+    newSlots = (struct Slot*)calloc(oldNumSlots * 2,
+        sizeof(struct Slot));
+
+    /* No expansion, so exit function. */
+    if(newSlots==NULL){
+        return;
+    }
+
+    oSymTable->slots = newSlots;
+    oSymTable->numSlots = oldNumSlots * 2;
+    oSymTable->hashShift -= 1;
+
+    /* Reinsert every binding using its stored hash code. */
+    for(index=0; index<oldNumSlots; index++){
+        if(oldSlots[index].key!=NULL){
+            SymTable_place(oSymTable, oldSlots[index].key,
+                oldSlots[index].hash, oldSlots[index].value);
+        }
+    }
+    free(oldSlots);
+}
+
+int SymTable_put(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    size_t uHash;
+    char *keyCopy;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uHash = SymTable_hash(pcKey);
+
+    if(SymTable_find(oSymTable, pcKey, uHash)!=oSymTable->numSlots){
+        return 0;
+    }
+
+    /* Expand once the load limit would be crossed. If expansion
+    fails, carry on as long as an empty slot will remain, since
+    lookups rely on meeting one. */
+    if((oSymTable->length + 1) * MAX_LOAD_DEN
+        > oSymTable->numSlots * MAX_LOAD_NUM){
+        SymTable_expand(oSymTable);
+        if(oSymTable->length + 1 >= oSymTable->numSlots){
+            return 0;
+        }
+    }
+
+    keyCopy = (char*)malloc(strlen(pcKey)+1);
+    if(keyCopy==NULL){
+        return 0;
+    }
+    strcpy(keyCopy, pcKey);
+
+    SymTable_place(oSymTable, keyCopy, uHash, pvValue);
+    oSymTable->length+=1;
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    size_t index;
+    const void *oldValue;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    index = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if(index==oSymTable->numSlots){
+        return NULL;
+    }
+
+    oldValue = oSymTable->slots[index].value;
+    oSymTable->slots[index].value = pvValue;
+    return (void*)oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    return SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey))
+        != oSymTable->numSlots;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    index = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if(index==oSymTable->numSlots){
+        return NULL;
+    }
+    return (void*)oSymTable->slots[index].value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    size_t mask;
+    size_t index;
+    size_t next;
+    const void *removedValue;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    index = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if(index==oSymTable->numSlots){
+        return NULL;
+    }
+
+    free((char*)oSymTable->slots[index].key);
+    removedValue = oSymTable->slots[index].value;
+    oSymTable->length-=1;
+
+    /* Backward-shift deletion: pull each following displaced binding
+    one slot back toward its home, so no tombstone is left behind. */
+    mask = oSymTable->numSlots - 1;
+    next = (index + 1) & mask;
+    while(oSymTable->slots[next].key!=NULL
+        && SymTable_distance(oSymTable, next)>0){
+        oSymTable->slots[index] = oSymTable->slots[next];
+        index = next;
+        next = (next + 1) & mask;
+    }
+    oSymTable->slots[index].key = NULL;
+
+    return (void*)removedValue;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra){
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    for(index=0; index<oSymTable->numSlots; index++){
+        if(oSymTable->slots[index].key!=NULL){
+            (*pfApply)(oSymTable->slots[index].key,
+            (void*)oSymTable->slots[index].value, (void*)pvExtra);
+        }
+    }
+}
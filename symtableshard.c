@@ -0,0 +1,482 @@
+/* symtableshard.c */
+/* Author: Vikram Kakaria */
+
+/* The concurrent build allocates tables with posix_memalign. */
+#ifdef SYMTABLE_CONCURRENT
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "symtable.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#ifdef SYMTABLE_CONCURRENT
+#include <pthread.h>
+#endif
+
+/* A SymTable here is a sharded hash table: SHARD_COUNT independent
+chained hash tables, the shards, each holding the keys whose hash
+codes have a given value in their top SHARD_BITS bits (once scrambled;
+see SymTable_shard). Each shard keeps its own bucket array and length,
+and expands on its own schedule, when it alone has more bindings than
+buckets, so a rehash moves only the bindings of one shard.
+
+If SYMTABLE_CONCURRENT is defined, any number of threads may call
+SymTable_put, SymTable_replace, SymTable_contains, SymTable_get,
+SymTable_remove, SymTable_getLength and SymTable_map on the same table
+at once. SymTable_new and SymTable_free must not overlap other calls
+on the table. Each shard is then guarded by a lock of its own, which
+is also held while the shard expands, so work on keys of other shards
+carries on meanwhile; there is no count of bindings shared by the
+shards for threads to contend over. SymTable_getLength adds up the
+lengths of the shards, and so may miss puts and removes that overlap
+it. SymTable_map walks one shard at a time while holding its lock, so
+pfApply must not call any function on the table; it sees each binding
+that is present throughout the call.
+
+Without SYMTABLE_CONCURRENT, the shards are never locked. */
+
+#ifdef SYMTABLE_CONCURRENT
+#ifndef __GNUC__
+#error "SYMTABLE_CONCURRENT needs the __atomic builtins of GCC or Clang"
+#endif
+
+/* Shards that different threads lock and change are kept in separate
+cache lines, so that they do not take the lines from each other. */
+#define CACHE_LINE_SIZE 64
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#else
+#define CACHE_ALIGNED
+#endif
+
+/* Number of bits of a hash code that select its shard, and the number
+of shards that makes. */
+#define SHARD_BITS 4
+#define SHARD_COUNT (1U << SHARD_BITS)
+
+/* Number of buckets of each shard of a new SymTable. Bucket counts
+are always powers of two, and Shard_expand doubles the count of a
+shard each time, for as long as memory allows. */
+#define INITIAL_BUCKET_COUNT 16
+
+/* A binding has a key and a value, and is a node of the chain of its
+bucket. The key's characters are stored after the binding, so each
+binding is a single allocation. */
+struct Binding {
+    /* Binding value */
+    const void *value;
+
+    /* Next binding in the same bucket */
+    struct Binding *next;
+
+    /* Full hash code of key, so that the shard never has to hash a
+    key again when it expands */
+    size_t hash;
+
+    /* Binding key, including its terminating null character */
+    char key[];
+};
+
+/* A shard is a chained hash table of its own. */
+struct Shard {
+#ifdef SYMTABLE_CONCURRENT
+    /* Held while the shard is read or changed */
+    pthread_mutex_t lock CACHE_ALIGNED;
+#endif
+
+    /* An array of buckets, where each bucket is functionally
+    similar to a linked list. */
+    struct Binding **buckets;
+
+    /* Tells number of buckets present. */
+    size_t numBuckets;
+
+    /* Tells number of bindings present. */
+    size_t length;
+};
+
+/* A SymTable (indicating a symbol table) consists of its shards. */
+struct SymTable {
+    /* The shards, selected by the top bits of the keys' hash codes. */
+    struct Shard shards[SHARD_COUNT];
+};
+
+/* Return a hash code for pcKey. */
+
+static size_t SymTable_hash(const char *pcKey)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+   return uHash;
+}
+
+/* Return the shard of oSymTable that keys whose hash code is uHash
+belong to. The hash codes of short keys have no high bits set, so the
+shard is taken from the top bits of the product of uHash with 2^64
+divided by the golden ratio (Fibonacci hashing), which depend on every
+bit of uHash. Buckets are selected by the low bits of uHash itself, so
+the keys of a shard still spread over all of its buckets. */
+static struct Shard *SymTable_shard(SymTable_T oSymTable, size_t uHash){
+    uint64_t uBits = (uint64_t)uHash * 0x9E3779B97F4A7C15ULL;
+
+    return &(oSymTable->shards)[uBits >> (64 - SHARD_BITS)];
+}
+
+/* Return the bucket for hash code uHash in an array of uBucketCount
+buckets. uBucketCount is a power of two, so the low bits of uHash
+select the bucket without any division. */
+static size_t SymTable_bucket(size_t uHash, size_t uBucketCount){
+    return uHash & (uBucketCount - 1);
+}
+
+/* Acquire the lock of poShard, in the concurrent build. */
+static void Shard_lock(struct Shard *poShard){
+#ifdef SYMTABLE_CONCURRENT
+    (void)pthread_mutex_lock(&poShard->lock);
+#else
+    (void)poShard;
+#endif
+}
+
+/* Release the lock of poShard, in the concurrent build. */
+static void Shard_unlock(struct Shard *poShard){
+#ifdef SYMTABLE_CONCURRENT
+    (void)pthread_mutex_unlock(&poShard->lock);
+#else
+    (void)poShard;
+#endif
+}
+
+/* Add iDelta to the length of poShard, which the caller holds. Other
+threads may read it meanwhile in SymTable_getLength, so in the
+concurrent build it is written atomically. */
+static void Shard_addLength(struct Shard *poShard, int iDelta){
+#ifdef SYMTABLE_CONCURRENT
+    __atomic_store_n(&poShard->length, poShard->length + (size_t)iDelta,
+        __ATOMIC_RELAXED);
+#else
+    poShard->length += (size_t)iDelta;
+#endif
+}
+
+/* This function seeks to expand poShard, which the caller holds, by
+doubling the number of buckets present. If not enough memory is
+available, then the shard is unchanged. The bindings are all moved at
+once, but only those of poShard. */
+static void Shard_expand(struct Shard *poShard){
+    struct Binding **newBuckets;
+    size_t newNumBuckets;
+    size_t newBucket;
+    size_t bucket;
+    struct Binding *thisBinding;
+    struct Binding *nextBinding;
+
+    /* Check to make sure that the doubled array can still be
+    addressed. */
+    if((poShard->numBuckets) >
+        ((size_t)-1) / 2 / sizeof(struct Binding*)){
+        return;
+    }
+    newNumBuckets = poShard->numBuckets * 2;
+
+    newBuckets = (struct Binding**)calloc(newNumBuckets,
+    sizeof(struct Binding*));
+
+    /* No expansion, so exit function. */
+    if(newBuckets==NULL){
+        return;
+    }
+
+    for(bucket = 0; bucket < poShard->numBuckets; bucket++){
+        for(thisBinding = (poShard->buckets)[bucket];
+        thisBinding != NULL; thisBinding = nextBinding){
+            nextBinding = thisBinding->next;
+            newBucket = SymTable_bucket(thisBinding->hash,
+            newNumBuckets);
+            thisBinding->next = newBuckets[newBucket];
+            newBuckets[newBucket] = thisBinding;
+        }
+    }
+
+    free(poShard->buckets);
+    poShard->buckets = newBuckets;
+    poShard->numBuckets = newNumBuckets;
+}
+
+/* Return the address of the link to the binding in poShard whose key
+is pcKey, whose hash code is uHash: the head of its chain, or the next
+of the binding before it. If there is no such binding, return the
+address of the NULL that ends its chain. The caller holds poShard. */
+static struct Binding **Shard_find(struct Shard *poShard,
+     const char *pcKey, size_t uHash){
+    struct Binding **link;
+
+    for(link = &(poShard->buckets)[SymTable_bucket(uHash,
+        poShard->numBuckets)];
+    *link != NULL; link = &(*link)->next){
+        if((*link)->hash==uHash && strcmp((*link)->key, pcKey)==0){
+            break;
+        }
+    }
+    return link;
+}
+
+SymTable_T SymTable_new(void){
+    SymTable_T oSymTable;
+    size_t shard;
+
+    /* Use memory allocation to create a SymTable_T of size of
+    the SymTable data structure. In the concurrent build it starts on
+    a cache line, as its cache-aligned shards assume. */
+#ifdef SYMTABLE_CONCURRENT
+    if(posix_memalign((void**)&oSymTable, CACHE_LINE_SIZE,
+        sizeof(struct SymTable))!=0){
+        return NULL;
+    }
+#else
+    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+
+    /* Not enough memory */
+    if(oSymTable==NULL){
+        return NULL;
+    }
+#endif
+
+    for(shard = 0; shard < SHARD_COUNT; shard++){
+        /* Calloc does NULL initialization for pointers. */
+        (oSymTable->shards)[shard].buckets = (struct Binding**)calloc(
+            INITIAL_BUCKET_COUNT, sizeof(struct Binding*));
+        (oSymTable->shards)[shard].numBuckets = INITIAL_BUCKET_COUNT;
+        (oSymTable->shards)[shard].length = 0;
+
+        /* Check if there is insufficient memory for bucket array, or
+        the lock cannot be made, and if so undo the shards so far. */
+        if((oSymTable->shards)[shard].buckets==NULL
+#ifdef SYMTABLE_CONCURRENT
+            || pthread_mutex_init(&(oSymTable->shards)[shard].lock,
+            NULL)!=0
+#endif
+            ){
+            free((oSymTable->shards)[shard].buckets);
+            while(shard>0){
+                shard--;
+                free((oSymTable->shards)[shard].buckets);
+#ifdef SYMTABLE_CONCURRENT
+                (void)pthread_mutex_destroy(
+                    &(oSymTable->shards)[shard].lock);
+#endif
+            }
+            free(oSymTable);
+            return NULL;
+        }
+    }
+    return oSymTable;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+    struct Shard *poShard;
+    struct Binding *thisBinding;
+    struct Binding *nextBinding;
+    size_t shard;
+    size_t bucket;
+
+    assert(oSymTable!=NULL);
+
+    for(shard = 0; shard < SHARD_COUNT; shard++){
+        poShard = &(oSymTable->shards)[shard];
+        for(bucket = 0; bucket < poShard->numBuckets; bucket++){
+            for(thisBinding = (poShard->buckets)[bucket];
+            thisBinding != NULL; thisBinding = nextBinding){
+                nextBinding = thisBinding->next;
+                free(thisBinding);
+            }
+        }
+        free(poShard->buckets);
+#ifdef SYMTABLE_CONCURRENT
+        (void)pthread_mutex_destroy(&poShard->lock);
+#endif
+    }
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    size_t length = 0;
+    size_t shard;
+
+    assert(oSymTable!=NULL);
+
+    for(shard = 0; shard < SHARD_COUNT; shard++){
+#ifdef SYMTABLE_CONCURRENT
+        length += __atomic_load_n(&(oSymTable->shards)[shard].length,
+            __ATOMIC_RELAXED);
+#else
+        length += (oSymTable->shards)[shard].length;
+#endif
+    }
+    return length;
+}
+
+int SymTable_put(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    struct Shard *poShard;
+    struct Binding **link;
+    struct Binding *newBinding;
+    size_t keySize;
+    size_t uHash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uHash = SymTable_hash(pcKey);
+    poShard = SymTable_shard(oSymTable, uHash);
+    Shard_lock(poShard);
+
+    /* Expand the shard if its number of bindings is greater than its
+    number of buckets. */
+    if(poShard->length > poShard->numBuckets){
+        Shard_expand(poShard);
+    }
+
+    link = Shard_find(poShard, pcKey, uHash);
+    if(*link!=NULL){
+        Shard_unlock(poShard);
+        return 0;
+    }
+
+    /* Define newBinding, with room after it for the key: key
+    length + 1 (for terminating null character). */
+    keySize = strlen(pcKey)+1;
+    newBinding = (struct Binding*)malloc(
+        offsetof(struct Binding, key) + keySize);
+    if(newBinding==NULL){
+        Shard_unlock(poShard);
+        return 0;
+    }
+    memcpy(newBinding->key, pcKey, keySize);
+    newBinding->value = pvValue;
+    newBinding->hash = uHash;
+
+    /* The new binding ends the chain, where Shard_find stopped. */
+    newBinding->next = NULL;
+    *link = newBinding;
+    Shard_addLength(poShard, 1);
+    Shard_unlock(poShard);
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    struct Shard *poShard;
+    struct Binding *binding;
+    const void *oldValue = NULL;
+    size_t uHash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uHash = SymTable_hash(pcKey);
+    poShard = SymTable_shard(oSymTable, uHash);
+    Shard_lock(poShard);
+    binding = *Shard_find(poShard, pcKey, uHash);
+    if(binding!=NULL){
+        oldValue = binding->value;
+        binding->value = pvValue;
+    }
+    Shard_unlock(poShard);
+    return (void*)oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    struct Shard *poShard;
+    int iFound;
+    size_t uHash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uHash = SymTable_hash(pcKey);
+    poShard = SymTable_shard(oSymTable, uHash);
+    Shard_lock(poShard);
+    iFound = *Shard_find(poShard, pcKey, uHash)!=NULL;
+    Shard_unlock(poShard);
+    return iFound;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct Shard *poShard;
+    struct Binding *binding;
+    const void *value = NULL;
+    size_t uHash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uHash = SymTable_hash(pcKey);
+    poShard = SymTable_shard(oSymTable, uHash);
+    Shard_lock(poShard);
+    binding = *Shard_find(poShard, pcKey, uHash);
+    if(binding!=NULL){
+        value = binding->value;
+    }
+    Shard_unlock(poShard);
+    return (void*)value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct Shard *poShard;
+    struct Binding **link;
+    struct Binding *thisBinding;
+    const void *removedValue = NULL;
+    size_t uHash;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uHash = SymTable_hash(pcKey);
+    poShard = SymTable_shard(oSymTable, uHash);
+    Shard_lock(poShard);
+    link = Shard_find(poShard, pcKey, uHash);
+    thisBinding = *link;
+    if(thisBinding!=NULL){
+        *link = thisBinding->next;
+        Shard_addLength(poShard, -1);
+        removedValue = thisBinding->value;
+        free(thisBinding);
+    }
+    Shard_unlock(poShard);
+    return (void*)removedValue;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra){
+    struct Shard *poShard;
+    struct Binding *thisBinding;
+    size_t shard;
+    size_t bucket;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    for(shard = 0; shard < SHARD_COUNT; shard++){
+        poShard = &(oSymTable->shards)[shard];
+        Shard_lock(poShard);
+        for(bucket = 0; bucket < poShard->numBuckets; bucket++){
+            for(thisBinding = (poShard->buckets)[bucket];
+            thisBinding != NULL; thisBinding = thisBinding->next){
+                (*pfApply)(thisBinding->key, (void*)thisBinding->value,
+                    (void*)pvExtra);
+            }
+        }
+        Shard_unlock(poShard);
+    }
+}
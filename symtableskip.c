@@ -0,0 +1,836 @@
+/* symtableskip.c */
+/* Author: Vikram Kakaria */
+
+/* The concurrent build allocates tables with posix_memalign. */
+#ifdef SYMTABLE_CONCURRENT
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "symtable.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#ifdef SYMTABLE_CONCURRENT
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/* A SymTable here is a skip list, which keeps its bindings in order of
+key (as strcmp orders them), so SymTable_map visits them in that order.
+
+If SYMTABLE_CONCURRENT is defined, the table is lock-free: any number
+of threads may call SymTable_put, SymTable_replace, SymTable_contains,
+SymTable_get, SymTable_remove, SymTable_getLength and SymTable_map on
+the same table at once. SymTable_new and SymTable_free must not overlap
+other calls on the table. SymTable_map then sees each binding that is
+present throughout the call, and may or may not see bindings that are
+added or removed while it runs. A binding is removed by first marking
+its links (see Link_MARK) and then unlinking it; every thread that
+meets a marked binding helps to unlink it.
+
+A removed binding cannot be freed while another thread may still be
+reading it. Every call that reads bindings counts itself in and out of
+a reader slot of the table (see struct ReaderSlot), and a binding is
+retired once it can no longer be reached: once the remove that marked
+it and the put that linked it have both unlinked it (see
+Binding_release). The table frees its retired bindings RETIRE_BATCH at
+a time, once every reader that was counted in when they were retired
+has counted out (see SymTable_synchronize). A remove called from
+pfApply leaves that to a later remove, since the walk of SymTable_map
+is itself a reader that would be waited for.
+
+Without SYMTABLE_CONCURRENT, the same algorithm runs with plain loads
+and stores, and a removed binding is freed as soon as it is unlinked. */
+
+#ifdef SYMTABLE_CONCURRENT
+#ifndef __GNUC__
+#error "SYMTABLE_CONCURRENT needs the __atomic builtins of GCC or Clang"
+#endif
+
+/* Memory that different threads write is kept in separate cache
+lines, so that they do not take the lines from each other. */
+#define CACHE_LINE_SIZE 64
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+
+/* Number of reader slots of a table. Threads are given slots in turn,
+so a slot is shared only by threads READER_SLOTS apart. */
+#define READER_SLOTS 64
+
+/* Number of retired bindings a table collects before it waits for
+the readers and frees them. */
+#define RETIRE_BATCH 64
+
+/* A slot in which readers count themselves in and out. Readers that
+arrive while the epoch of the table is even count themselves in
+count[0], and the others in count[1]. */
+struct ReaderSlot {
+    /* The number of readers of each parity in the slot */
+    size_t count[2] CACHE_ALIGNED;
+};
+#endif
+
+/* Number of levels of links. A binding is given each level above the
+first with probability 1/4, so the list stays shallow for any table
+that fits in memory. */
+#define MAX_LEVEL 16
+
+/* The low bit of a link is set once the binding holding the link has
+started to be removed; nothing may be linked after it at that level
+any more. Bindings are aligned, so the bit is otherwise zero. */
+#define Link_MARK ((uintptr_t)1)
+
+/* A binding has a key and a value, and a tower of links to the next
+binding at each of its levels. The key's characters are stored after
+the tower, so each binding is a single allocation. */
+struct Binding {
+    /* Binding key, stored after next */
+    const char *key;
+
+    /* Binding value */
+    const void *value;
+
+#ifdef SYMTABLE_CONCURRENT
+    /* Next removed binding, while this one awaits being freed */
+    struct Binding *retired;
+#endif
+
+    /* The number of the put that linked the binding and the remove
+    that marked it which have yet to finish with it */
+    unsigned int holds;
+
+    /* Number of levels this binding is linked at */
+    unsigned int height;
+
+    /* Links to the next binding at each level, as uintptr_t so that
+    they can carry Link_MARK */
+    uintptr_t next[];
+};
+
+/* A SymTable (indicating a symbol table) is a skip list: a sorted
+linked list of bindings at level 0, with sparser lists above it that
+let a search skip ahead. */
+struct SymTable {
+    /* Head of the list, which holds no key and has every level. */
+    struct Binding *head;
+
+    /* Tells number of bindings present. */
+    size_t length;
+
+    /* Count of bindings ever made, from which heights are drawn. */
+    size_t made;
+
+#ifdef SYMTABLE_CONCURRENT
+    /* Removed bindings, linked through retired. */
+    struct Binding *retired;
+
+    /* The number of bindings in retired, roughly */
+    size_t retiredCount;
+
+    /* The number of grace periods begun; its parity tells arriving
+    readers which count of their slot to count themselves in. */
+    unsigned int epoch;
+
+    /* Held while waiting for readers, so that one thread at a time
+    advances the epoch. */
+    pthread_mutex_t reclaimLock;
+
+    /* The slots in which readers count themselves in and out */
+    struct ReaderSlot readers[READER_SLOTS];
+#endif
+};
+
+/* Return *puLink. */
+static uintptr_t Link_load(uintptr_t *puLink){
+#ifdef SYMTABLE_CONCURRENT
+    return __atomic_load_n(puLink, __ATOMIC_ACQUIRE);
+#else
+    return *puLink;
+#endif
+}
+
+/* If *puLink is uExpected, set it to uDesired and return 1 (for
+true); otherwise return 0 (for false). */
+static int Link_cas(uintptr_t *puLink, uintptr_t uExpected,
+     uintptr_t uDesired){
+#ifdef SYMTABLE_CONCURRENT
+    return __atomic_compare_exchange_n(puLink, &uExpected, uDesired, 0,
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#else
+    if(*puLink!=uExpected){
+        return 0;
+    }
+    *puLink = uDesired;
+    return 1;
+#endif
+}
+
+/* Return the binding uLink points to, without its mark. */
+static struct Binding *Link_target(uintptr_t uLink){
+    return (struct Binding*)(uLink & ~Link_MARK);
+}
+
+/* Add iDelta to *puCount and return its previous value. */
+static size_t Count_add(size_t *puCount, int iDelta){
+#ifdef SYMTABLE_CONCURRENT
+    return __atomic_fetch_add(puCount, (size_t)iDelta, __ATOMIC_RELAXED);
+#else
+    size_t uOld = *puCount;
+    *puCount += (size_t)iDelta;
+    return uOld;
+#endif
+}
+
+/* Return the number of levels of the next binding made in oSymTable.
+The count of bindings made is scrambled (by the splitmix64 finalizer)
+into random bits, each pair of which continues the tower with
+probability 1/4. This needs no random number state to be shared
+between threads. */
+static unsigned int SymTable_height(SymTable_T oSymTable){
+    uint64_t uBits;
+    unsigned int height = 1;
+
+    uBits = (uint64_t)Count_add(&oSymTable->made, 1);
+    uBits += 0x9E3779B97F4A7C15ULL;
+    uBits = (uBits ^ (uBits >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    uBits = (uBits ^ (uBits >> 27)) * 0x94D049BB133111EBULL;
+    uBits ^= uBits >> 31;
+
+    while(height<MAX_LEVEL && (uBits & 3)==0){
+        height += 1;
+        uBits >>= 2;
+    }
+    return height;
+}
+
+/* Return a new binding of uHeight levels with a copy of pcKey and
+value pvValue, not yet linked, or NULL if not enough memory is
+available. */
+static struct Binding *Binding_new(const char *pcKey,
+     const void *pvValue, unsigned int uHeight){
+    struct Binding *binding;
+    size_t keySize = strlen(pcKey)+1;
+    size_t towerSize = uHeight * sizeof(uintptr_t);
+
+    binding = (struct Binding*)malloc(
+        offsetof(struct Binding, next) + towerSize + keySize);
+    if(binding==NULL){
+        return NULL;
+    }
+    binding->key = (char*)binding->next + towerSize;
+    memcpy((char*)binding->key, pcKey, keySize);
+    binding->value = pvValue;
+#ifdef SYMTABLE_CONCURRENT
+    binding->retired = NULL;
+#endif
+    binding->holds = 2;
+    binding->height = uHeight;
+    return binding;
+}
+
+#ifdef SYMTABLE_CONCURRENT
+/* The number of the calling thread among those that have read a
+table, from 1, or 0 if it has not read one yet. */
+static __thread unsigned int uThreadNumber;
+
+/* The number of times the calling thread is counted in as a reader,
+of any table. */
+static __thread unsigned int uReadDepth;
+
+/* The number of threads that have read a table. */
+static unsigned int uReaderThreads;
+#endif
+
+/* Count the calling thread in as a reader of oSymTable, so that no
+binding it reaches from now on is freed until it counts itself out
+with SymTable_readEnd. Return its slot, and set *puParity to the count
+of the slot it was counted in. Without SYMTABLE_CONCURRENT, there are
+no slots, and NULL is returned. */
+static struct ReaderSlot *SymTable_readBegin(SymTable_T oSymTable,
+     unsigned int *puParity){
+#ifdef SYMTABLE_CONCURRENT
+    struct ReaderSlot *slot;
+    unsigned int parity;
+
+    if(uThreadNumber==0){
+        uThreadNumber = __atomic_add_fetch(&uReaderThreads, 1,
+        __ATOMIC_RELAXED);
+    }
+    slot = &(oSymTable->readers)[uThreadNumber % READER_SLOTS];
+
+    /* A reader counted in under an epoch that has since ended might
+    not be waited for by the grace period that ended it, so it checks
+    the epoch again once counted in, and counts itself in anew if it
+    has moved on. */
+    for(;;){
+        parity = __atomic_load_n(&oSymTable->epoch, __ATOMIC_RELAXED) & 1;
+        (void)__atomic_fetch_add(&slot->count[parity], 1,
+        __ATOMIC_SEQ_CST);
+        if((__atomic_load_n(&oSymTable->epoch, __ATOMIC_SEQ_CST) & 1)
+            == parity){
+            break;
+        }
+        (void)__atomic_fetch_sub(&slot->count[parity], 1,
+        __ATOMIC_RELEASE);
+    }
+    uReadDepth++;
+    *puParity = parity;
+    return slot;
+#else
+    (void)oSymTable;
+    *puParity = 0;
+    return NULL;
+#endif
+}
+
+/* Count a reader out of poSlot, in which SymTable_readBegin counted it
+in with parity uParity. */
+static void SymTable_readEnd(struct ReaderSlot *poSlot,
+     unsigned int uParity){
+#ifdef SYMTABLE_CONCURRENT
+    uReadDepth--;
+    (void)__atomic_fetch_sub(&poSlot->count[uParity], 1,
+    __ATOMIC_RELEASE);
+#else
+    (void)poSlot;
+    (void)uParity;
+#endif
+}
+
+#ifdef SYMTABLE_CONCURRENT
+/* Wait until every reader that was counted in to oSymTable when this
+function was called has counted itself out. Bindings that such readers
+might have reached, and that no reader can reach any more, can then be
+freed. Readers arriving meanwhile are counted under the next epoch,
+and not waited for. */
+static void SymTable_synchronize(SymTable_T oSymTable){
+    unsigned int parity;
+    size_t slot;
+
+    (void)pthread_mutex_lock(&oSymTable->reclaimLock);
+    parity = oSymTable->epoch & 1;
+    __atomic_store_n(&oSymTable->epoch, oSymTable->epoch + 1,
+    __ATOMIC_SEQ_CST);
+    for(slot = 0; slot < READER_SLOTS; slot++){
+        while(__atomic_load_n(&(oSymTable->readers)[slot].count[parity],
+            __ATOMIC_SEQ_CST)!=0){
+            (void)sched_yield();
+        }
+    }
+    (void)pthread_mutex_unlock(&oSymTable->reclaimLock);
+}
+
+/* Free the bindings oSymTable has retired, once no reader can be
+reading them, if there are RETIRE_BATCH of them. The calling thread
+must not be counted in as a reader, of oSymTable or any other table,
+since it would wait for itself. */
+static void SymTable_reclaim(SymTable_T oSymTable){
+    struct Binding *retired;
+    struct Binding *next;
+
+    if(uReadDepth!=0 || __atomic_load_n(&oSymTable->retiredCount,
+        __ATOMIC_RELAXED) < RETIRE_BATCH){
+        return;
+    }
+
+    /* Bindings retired from now on wait for the next batch. */
+    __atomic_store_n(&oSymTable->retiredCount, 0, __ATOMIC_RELAXED);
+    retired = __atomic_exchange_n(&oSymTable->retired, NULL,
+        __ATOMIC_ACQUIRE);
+    if(retired==NULL){
+        return;
+    }
+
+    SymTable_synchronize(oSymTable);
+    for(; retired != NULL; retired = next){
+        next = retired->retired;
+        free(retired);
+    }
+}
+#endif
+
+/* Return 1 (for true) if poBinding has been removed, or 0 (for false)
+otherwise. In the concurrent build the check is an update of the link,
+so that the remove, if it comes later, sees every link made to
+poBinding before the check. */
+static int Binding_isRemoved(struct Binding *poBinding){
+    uintptr_t uNext;
+
+    do{
+        uNext = Link_load(&poBinding->next[0]);
+    }while(!(uNext & Link_MARK)
+        && !Link_cas(&poBinding->next[0], uNext, uNext));
+    return (uNext & Link_MARK)!=0;
+}
+
+/* Record that the put that linked poBinding, or the remove that
+marked it, has finished with it: the put is done linking it, and the
+remove has unlinked it. Once both have, poBinding can no longer be
+reached, and it is retired to oSymTable, or, with no other thread to be
+reading it, freed. */
+static void Binding_release(SymTable_T oSymTable,
+     struct Binding *poBinding){
+#ifdef SYMTABLE_CONCURRENT
+    if(__atomic_sub_fetch(&poBinding->holds, 1, __ATOMIC_ACQ_REL)!=0){
+        return;
+    }
+    poBinding->retired = __atomic_load_n(&oSymTable->retired,
+        __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(&oSymTable->retired,
+        &poBinding->retired, poBinding, 0, __ATOMIC_RELEASE,
+        __ATOMIC_RELAXED)){
+    }
+    (void)__atomic_add_fetch(&oSymTable->retiredCount, 1,
+        __ATOMIC_RELAXED);
+#else
+    (void)oSymTable;
+    if(--poBinding->holds==0){
+        free(poBinding);
+    }
+#endif
+}
+
+/* Find where pcKey belongs in oSymTable: set apoPreds[level] to the
+last binding at each level whose key is less than pcKey, and
+apoSuccs[level] to the binding after it (or NULL). Marked bindings met
+on the way are unlinked. Return 1 (for true) if apoSuccs[0] holds
+pcKey, or 0 (for false) otherwise. */
+static int SymTable_find(SymTable_T oSymTable, const char *pcKey,
+     struct Binding *apoPreds[], struct Binding *apoSuccs[]){
+    struct Binding *pred;
+    struct Binding *curr;
+    uintptr_t uSucc;
+    int level;
+
+retry:
+    pred = oSymTable->head;
+    for(level = MAX_LEVEL-1; level >= 0; level--){
+        curr = Link_target(Link_load(&pred->next[level]));
+        while(curr!=NULL){
+            uSucc = Link_load(&curr->next[level]);
+
+            /* curr is being removed: unlink it at this level. If pred
+            changed meanwhile, start over from the head. */
+            if(uSucc & Link_MARK){
+                if(!Link_cas(&pred->next[level], (uintptr_t)curr,
+                    uSucc & ~Link_MARK)){
+                    goto retry;
+                }
+                curr = Link_target(uSucc);
+                continue;
+            }
+            if(strcmp(curr->key, pcKey)>=0){
+                break;
+            }
+            pred = curr;
+            curr = Link_target(uSucc);
+        }
+        apoPreds[level] = pred;
+        apoSuccs[level] = curr;
+    }
+    return apoSuccs[0]!=NULL && strcmp(apoSuccs[0]->key, pcKey)==0;
+}
+
+/* Unlink poBinding, which is marked, at every level of oSymTable at
+which it is still linked. A put of the same key may have linked a new
+binding in front of it since it was marked, and SymTable_find stops at
+that binding, so this pass goes on over bindings with an equal key and
+stops only at a greater one. */
+static void SymTable_unlinkMarked(SymTable_T oSymTable,
+     struct Binding *poBinding){
+    struct Binding *pred;
+    struct Binding *scan;
+    struct Binding *curr;
+    uintptr_t uSucc;
+    int iCompare;
+    int level;
+
+retry:
+    pred = oSymTable->head;
+    for(level = MAX_LEVEL-1; level >= 0; level--){
+        /* pred stays at the last key less than poBinding's, so that
+        the next level down starts before every equal key; scan is the
+        binding whose link a marked curr is unlinked from. */
+        scan = pred;
+        curr = Link_target(Link_load(&pred->next[level]));
+        while(curr!=NULL){
+            uSucc = Link_load(&curr->next[level]);
+            if(uSucc & Link_MARK){
+                if(!Link_cas(&scan->next[level], (uintptr_t)curr,
+                    uSucc & ~Link_MARK)){
+                    goto retry;
+                }
+                curr = Link_target(uSucc);
+                continue;
+            }
+            iCompare = strcmp(curr->key, poBinding->key);
+            if(iCompare>0){
+                break;
+            }
+            if(iCompare<0){
+                pred = curr;
+            }
+            scan = curr;
+            curr = Link_target(uSucc);
+        }
+    }
+}
+
+/* Return the binding in oSymTable whose key is pcKey, or NULL if there
+is no such binding. Unlike SymTable_find, this never writes, and never
+has to start over. */
+static struct Binding *SymTable_lookup(SymTable_T oSymTable,
+     const char *pcKey){
+    struct Binding *pred = oSymTable->head;
+    struct Binding *curr = NULL;
+    uintptr_t uSucc;
+    int iCompare;
+    int level;
+
+    for(level = MAX_LEVEL-1; level >= 0; level--){
+        curr = Link_target(Link_load(&pred->next[level]));
+        while(curr!=NULL){
+            /* Step over bindings that are being removed. */
+            uSucc = Link_load(&curr->next[level]);
+            if(uSucc & Link_MARK){
+                curr = Link_target(uSucc);
+                continue;
+            }
+            iCompare = strcmp(curr->key, pcKey);
+            if(iCompare>0){
+                break;
+            }
+            if(iCompare==0){
+                return curr;
+            }
+            pred = curr;
+            curr = Link_target(uSucc);
+        }
+    }
+    return NULL;
+}
+
+SymTable_T SymTable_new(void){
+    SymTable_T oSymTable;
+    int level;
+
+    /* In the concurrent build the table starts on a cache line, as
+    its cache-aligned reader slots assume. */
+#ifdef SYMTABLE_CONCURRENT
+    if(posix_memalign((void**)&oSymTable, CACHE_LINE_SIZE,
+        sizeof(struct SymTable))!=0){
+        return NULL;
+    }
+#else
+    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+
+    /* Not enough memory */
+    if(oSymTable==NULL){
+        return NULL;
+    }
+#endif
+
+    oSymTable->head = Binding_new("", NULL, MAX_LEVEL);
+    if(oSymTable->head==NULL){
+        free(oSymTable);
+        return NULL;
+    }
+#ifdef SYMTABLE_CONCURRENT
+    if(pthread_mutex_init(&oSymTable->reclaimLock, NULL)!=0){
+        free(oSymTable->head);
+        free(oSymTable);
+        return NULL;
+    }
+#endif
+    for(level = 0; level < MAX_LEVEL; level++){
+        oSymTable->head->next[level] = 0;
+    }
+    oSymTable->length = 0;
+    oSymTable->made = 0;
+#ifdef SYMTABLE_CONCURRENT
+    oSymTable->retired = NULL;
+    oSymTable->retiredCount = 0;
+    oSymTable->epoch = 0;
+    memset(oSymTable->readers, 0, sizeof(oSymTable->readers));
+#endif
+    return oSymTable;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+    struct Binding *thisBinding;
+    struct Binding *nextBinding;
+
+    assert(oSymTable!=NULL);
+
+    /* Every binding still present is on level 0. Removed ones are
+    unlinked from it before their removal completes, so they are
+    only on the retired list, in the concurrent build. */
+    for(thisBinding = oSymTable->head; thisBinding != NULL;
+    thisBinding = nextBinding){
+        nextBinding = Link_target(thisBinding->next[0]);
+        free(thisBinding);
+    }
+#ifdef SYMTABLE_CONCURRENT
+    for(thisBinding = oSymTable->retired; thisBinding != NULL;
+    thisBinding = nextBinding){
+        nextBinding = thisBinding->retired;
+        free(thisBinding);
+    }
+    (void)pthread_mutex_destroy(&oSymTable->reclaimLock);
+#endif
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+#ifdef SYMTABLE_CONCURRENT
+    return __atomic_load_n(&oSymTable->length, __ATOMIC_RELAXED);
+#else
+    return oSymTable->length;
+#endif
+}
+
+/* Link poBinding, which has just been linked in at level 0 of
+oSymTable after apoPreds[0], into the levels above, where apoPreds and
+apoSuccs are the bindings it belongs between. This only speeds up
+searches. If poBinding starts being removed meanwhile, stop. */
+static void SymTable_linkAbove(SymTable_T oSymTable,
+     struct Binding *poBinding, struct Binding *apoPreds[],
+     struct Binding *apoSuccs[]){
+    uintptr_t uNext;
+    unsigned int level;
+
+    for(level = 1; level < poBinding->height; level++){
+        for(;;){
+            uNext = Link_load(&poBinding->next[level]);
+            if(uNext & Link_MARK){
+                return;
+            }
+            if(uNext!=(uintptr_t)apoSuccs[level]
+                && !Link_cas(&poBinding->next[level], uNext,
+                (uintptr_t)apoSuccs[level])){
+                continue;
+            }
+            if(Link_cas(&apoPreds[level]->next[level],
+                (uintptr_t)apoSuccs[level], (uintptr_t)poBinding)){
+                break;
+            }
+            if(!SymTable_find(oSymTable, poBinding->key, apoPreds,
+                apoSuccs) || apoSuccs[0]!=poBinding){
+                return;
+            }
+        }
+    }
+}
+
+/* Add a binding to oSymTable with key pcKey and value pvValue, and
+return 1 (for true), unless there already is a binding whose key is
+pcKey, or not enough memory is available, in which case return 0 (for
+false). The caller is counted in as a reader. */
+static int SymTable_link(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    struct Binding *apoPreds[MAX_LEVEL];
+    struct Binding *apoSuccs[MAX_LEVEL];
+    struct Binding *newBinding = NULL;
+    unsigned int level;
+
+    /* Link the new binding in at level 0, which makes it present. */
+    for(;;){
+        if(SymTable_find(oSymTable, pcKey, apoPreds, apoSuccs)){
+            free(newBinding);
+            return 0;
+        }
+        if(newBinding==NULL){
+            newBinding = Binding_new(pcKey, pvValue,
+                SymTable_height(oSymTable));
+            if(newBinding==NULL){
+                return 0;
+            }
+        }
+        for(level = 0; level < newBinding->height; level++){
+            newBinding->next[level] = (uintptr_t)apoSuccs[level];
+        }
+        if(Link_cas(&apoPreds[0]->next[0], (uintptr_t)apoSuccs[0],
+            (uintptr_t)newBinding)){
+            break;
+        }
+    }
+    Count_add(&oSymTable->length, 1);
+    SymTable_linkAbove(oSymTable, newBinding, apoPreds, apoSuccs);
+
+    /* A remove that overlapped the linking may have unlinked the new
+    binding before some of its links were made, so those links are
+    undone here. */
+    if(Binding_isRemoved(newBinding)){
+        SymTable_unlinkMarked(oSymTable, newBinding);
+    }
+    Binding_release(oSymTable, newBinding);
+    return 1;
+}
+
+int SymTable_put(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    struct ReaderSlot *slot;
+    unsigned int parity;
+    int iSuccessful;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    slot = SymTable_readBegin(oSymTable, &parity);
+    iSuccessful = SymTable_link(oSymTable, pcKey, pvValue);
+    SymTable_readEnd(slot, parity);
+    return iSuccessful;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    struct ReaderSlot *slot;
+    unsigned int parity;
+    struct Binding *binding;
+    const void *oldValue = NULL;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    slot = SymTable_readBegin(oSymTable, &parity);
+    binding = SymTable_lookup(oSymTable, pcKey);
+
+    /* A replace that overlaps the removal of the same key counts as
+    coming just before it. */
+    if(binding!=NULL){
+#ifdef SYMTABLE_CONCURRENT
+        oldValue = __atomic_exchange_n(&binding->value, pvValue,
+            __ATOMIC_ACQ_REL);
+#else
+        oldValue = binding->value;
+        binding->value = pvValue;
+#endif
+    }
+    SymTable_readEnd(slot, parity);
+    return (void*)oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    struct ReaderSlot *slot;
+    unsigned int parity;
+    int iFound;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    slot = SymTable_readBegin(oSymTable, &parity);
+    iFound = SymTable_lookup(oSymTable, pcKey)!=NULL;
+    SymTable_readEnd(slot, parity);
+    return iFound;
+}
+
+/* Return the value of poBinding. */
+static void *Binding_value(struct Binding *poBinding){
+#ifdef SYMTABLE_CONCURRENT
+    return (void*)__atomic_load_n(&poBinding->value, __ATOMIC_ACQUIRE);
+#else
+    return (void*)poBinding->value;
+#endif
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct ReaderSlot *slot;
+    unsigned int parity;
+    struct Binding *binding;
+    void *value = NULL;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    slot = SymTable_readBegin(oSymTable, &parity);
+    binding = SymTable_lookup(oSymTable, pcKey);
+    if(binding!=NULL){
+        value = Binding_value(binding);
+    }
+    SymTable_readEnd(slot, parity);
+    return value;
+}
+
+/* If there is a binding in oSymTable whose key is pcKey, remove it
+and return its value, or return NULL if there is none. The caller is
+counted in as a reader. */
+static void *SymTable_unlink(SymTable_T oSymTable, const char *pcKey){
+    struct Binding *apoPreds[MAX_LEVEL];
+    struct Binding *apoSuccs[MAX_LEVEL];
+    struct Binding *victim;
+    void *removedValue;
+    uintptr_t uNext;
+    int level;
+
+    if(!SymTable_find(oSymTable, pcKey, apoPreds, apoSuccs)){
+        return NULL;
+    }
+    victim = apoSuccs[0];
+
+    /* Mark the links of the binding from the top down. Whichever
+    thread marks level 0 has removed it. */
+    for(level = (int)victim->height-1; level >= 0; level--){
+        for(;;){
+            uNext = Link_load(&victim->next[level]);
+            if(uNext & Link_MARK){
+                if(level==0){
+                    return NULL;
+                }
+                break;
+            }
+            if(Link_cas(&victim->next[level], uNext, uNext | Link_MARK)){
+                break;
+            }
+        }
+    }
+    Count_add(&oSymTable->length, -1);
+
+    /* Unlink the binding at every level, then let it go. */
+    SymTable_unlinkMarked(oSymTable, victim);
+    removedValue = Binding_value(victim);
+    Binding_release(oSymTable, victim);
+    return removedValue;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct ReaderSlot *slot;
+    unsigned int parity;
+    void *removedValue;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    slot = SymTable_readBegin(oSymTable, &parity);
+    removedValue = SymTable_unlink(oSymTable, pcKey);
+    SymTable_readEnd(slot, parity);
+#ifdef SYMTABLE_CONCURRENT
+    SymTable_reclaim(oSymTable);
+#endif
+    return removedValue;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra){
+    struct ReaderSlot *slot;
+    unsigned int parity;
+    struct Binding *binding;
+    uintptr_t uNext;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    slot = SymTable_readBegin(oSymTable, &parity);
+    binding = Link_target(Link_load(&oSymTable->head->next[0]));
+    while(binding!=NULL){
+        uNext = Link_load(&binding->next[0]);
+        if(!(uNext & Link_MARK)){
+            (*pfApply)(binding->key, Binding_value(binding),
+                (void*)pvExtra);
+        }
+        binding = Link_target(uNext);
+    }
+    SymTable_readEnd(slot, parity);
+}
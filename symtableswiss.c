@@ -0,0 +1,501 @@
+/* symtableswiss.c */
+/* Author: Vikram Kakaria */
+
+#include "symtable.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Number of slots whose control bytes are examined together. */
+#define GROUP_WIDTH 16
+
+/* Number of slots in a new SymTable. Must be a power of two and a
+multiple of GROUP_WIDTH. */
+#define INITIAL_SLOT_COUNT 512
+
+/* The table is rebuilt once more than MAX_LOAD_NUM/MAX_LOAD_DEN of
+its slots are either occupied or hold a tombstone. */
+#define MAX_LOAD_NUM 7
+#define MAX_LOAD_DEN 8
+
+/* Control byte values. A slot holding a binding has a control byte
+between 0 and 0x7F holding 7 bits of its key's hash code; the two
+other states both have the high bit set. */
+#define CTRL_EMPTY ((unsigned char)0x80)
+#define CTRL_DELETED ((unsigned char)0xFE)
+
+/* Multiplier used when mixing a hash code, so that both the group
+index (taken from the top bits) and the 7-bit fingerprint (taken from
+the bottom bits) depend on every character of the key. */
+#if SIZE_MAX > 0xFFFFFFFFUL
+#define HASH_MIX ((size_t)0xFF51AFD7ED558CCDULL)
+#define HASH_MIX_SHIFT 33
+#else
+#define HASH_MIX ((size_t)0x85EBCA6BUL)
+#define HASH_MIX_SHIFT 16
+#endif
+
+/* A slot of the table. Whether it is in use is recorded only in the
+control byte array. The full (mixed) hash code is kept so that the
+table can be rebuilt without reading any key strings. */
+struct Slot {
+    /* Slot key */
+    const char *key;
+
+    /* Slot value */
+    const void *value;
+
+    /* Mixed hash code of key */
+    size_t hash;
+};
+
+/* A SymTable (indicating a symbol table) is an open-addressed table
+split into groups of GROUP_WIDTH slots. A separate array holds one
+control byte per slot, so a whole group can be screened for a key's
+fingerprint with a single vector comparison before any key string is
+compared. Probing moves between groups, and stops at the first group
+that still has an empty slot. */
+struct SymTable {
+    /* One control byte per slot. */
+    unsigned char *ctrl;
+
+    /* The array of slots. */
+    struct Slot *slots;
+
+    /* Tells number of bindings present. */
+    size_t length;
+
+    /* Tells number of tombstones present. */
+    size_t numDeleted;
+
+    /* Tells number of slots present (a power of two). */
+    size_t numSlots;
+
+    /* Number of bits to shift a mixed hash code right by to get a
+    group index. */
+    unsigned int hashShift;
+};
+
+/* Return a hash code for pcKey. The multiplicative hash is followed by
+a mixing step, because fingerprints and group indices are taken from
+opposite ends of the result. */
+static size_t SymTable_hash(const char *pcKey)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+   uHash ^= uHash >> HASH_MIX_SHIFT;
+   uHash *= HASH_MIX;
+   uHash ^= uHash >> HASH_MIX_SHIFT;
+   return uHash;
+}
+
+/* Return the 7-bit fingerprint stored in the control byte of a
+binding whose hash code is uHash. */
+static unsigned char SymTable_fingerprint(size_t uHash){
+    return (unsigned char)(uHash & 0x7F);
+}
+
+/*--------------------------------------------------------------------*/
+/* Group operations. Each returns a bit mask with bit i set when the  */
+/* i-th control byte of the group starting at pucCtrl matches.        */
+
+#ifdef __SSE2__
+
+/* Match control bytes equal to ucByte. */
+static unsigned int Group_matchByte(const unsigned char *pucCtrl,
+     unsigned char ucByte){
+    __m128i group = _mm_loadu_si128((const __m128i*)pucCtrl);
+    __m128i wanted = _mm_set1_epi8((char)ucByte);
+    return (unsigned int)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, wanted));
+}
+
+/* Match control bytes of slots without a binding (empty or
+tombstone), which are exactly those with the high bit set. */
+static unsigned int Group_matchAvailable(const unsigned char *pucCtrl){
+    __m128i group = _mm_loadu_si128((const __m128i*)pucCtrl);
+    return (unsigned int)_mm_movemask_epi8(group);
+}
+
+#else
+
+/* Match control bytes equal to ucByte. */
+static unsigned int Group_matchByte(const unsigned char *pucCtrl,
+     unsigned char ucByte){
+    unsigned int mask = 0;
+    int i;
+
+    for(i=0; i<GROUP_WIDTH; i++){
+        if(pucCtrl[i]==ucByte){
+            mask |= 1U << i;
+        }
+    }
+    return mask;
+}
+
+/* Match control bytes of slots without a binding (empty or
+tombstone), which are exactly those with the high bit set. */
+static unsigned int Group_matchAvailable(const unsigned char *pucCtrl){
+    unsigned int mask = 0;
+    int i;
+
+    for(i=0; i<GROUP_WIDTH; i++){
+        if(pucCtrl[i] & 0x80){
+            mask |= 1U << i;
+        }
+    }
+    return mask;
+}
+
+#endif
+
+/* Return the index of the lowest set bit of the nonzero uMask. */
+static unsigned int Group_lowestBit(unsigned int uMask){
+#ifdef __GNUC__
+    return (unsigned int)__builtin_ctz(uMask);
+#else
+    unsigned int bit = 0;
+
+    while((uMask & 1U)==0){
+        uMask >>= 1;
+        bit += 1;
+    }
+    return bit;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the first slot of the group at which the probe
+for a key whose hash code is uHash starts. */
+static size_t SymTable_firstGroup(SymTable_T oSymTable, size_t uHash){
+    return (uHash >> oSymTable->hashShift) * GROUP_WIDTH;
+}
+
+/* Return the first slot index of the group after uGroup in the probe
+sequence, where uStep is the number of groups visited so far. Steps of
+1, 2, 3, ... groups visit every group exactly once before repeating,
+since the number of groups is a power of two. */
+static size_t SymTable_nextGroup(SymTable_T oSymTable, size_t uGroup,
+     size_t uStep){
+    return (uGroup + uStep * GROUP_WIDTH) & (oSymTable->numSlots - 1);
+}
+
+/* Return the value of hashShift for a table of uNumSlots slots. */
+static unsigned int SymTable_shiftFor(size_t uNumSlots){
+    unsigned int shift = (unsigned int)(sizeof(size_t) * CHAR_BIT);
+
+    uNumSlots /= GROUP_WIDTH;
+    while(uNumSlots > 1){
+        uNumSlots >>= 1;
+        shift -= 1;
+    }
+    return shift;
+}
+
+/* Return the index of the slot holding pcKey (whose hash code is
+uHash) in oSymTable, or numSlots if there is no such slot. If
+puAvailable is not NULL and pcKey is absent, store in *puAvailable
+the index of the first slot along pcKey's probe sequence that has no
+binding, which is where pcKey would be inserted. */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+     size_t uHash, size_t *puAvailable){
+    unsigned char fingerprint = SymTable_fingerprint(uHash);
+    size_t group = SymTable_firstGroup(oSymTable, uHash);
+    size_t step;
+    size_t index;
+    unsigned int mask;
+    int availableFound = 0;
+
+    for(step = 1; ; step++){
+        /* Compare keys only in slots whose fingerprint matches. */
+        mask = Group_matchByte(&oSymTable->ctrl[group], fingerprint);
+        while(mask!=0){
+            index = group + Group_lowestBit(mask);
+            if(oSymTable->slots[index].hash==uHash
+                && strcmp(pcKey, oSymTable->slots[index].key)==0){
+                return index;
+            }
+            mask &= mask - 1;
+        }
+
+        mask = Group_matchAvailable(&oSymTable->ctrl[group]);
+        if(mask!=0 && !availableFound){
+            availableFound = 1;
+            if(puAvailable!=NULL){
+                *puAvailable = group + Group_lowestBit(mask);
+            }
+        }
+
+        /* No key probes past a group that has an empty slot. */
+        if(Group_matchByte(&oSymTable->ctrl[group], CTRL_EMPTY)!=0){
+            return oSymTable->numSlots;
+        }
+        group = SymTable_nextGroup(oSymTable, group, step);
+    }
+}
+
+/* Allocate control bytes and slots for uNumSlots slots in oSymTable,
+all empty. Return 1 on success, or 0 (leaving oSymTable unchanged) if
+not enough memory is available. */
+static int SymTable_allocSlots(SymTable_T oSymTable, size_t uNumSlots){
+    unsigned char *ctrl;
+    struct Slot *slots;
+
+    ctrl = (unsigned char*)malloc(uNumSlots);
+    if(ctrl==NULL){
+        return 0;
+    }
+    slots = (struct Slot*)malloc(uNumSlots * sizeof(struct Slot));
+    if(slots==NULL){
+        free(ctrl);
+        return 0;
+    }
+    memset(ctrl, CTRL_EMPTY, uNumSlots);
+
+    oSymTable->ctrl = ctrl;
+    oSymTable->slots = slots;
+    oSymTable->numSlots = uNumSlots;
+    oSymTable->numDeleted = 0;
+    oSymTable->hashShift = SymTable_shiftFor(uNumSlots);
+    return 1;
+}
+
+SymTable_T SymTable_new(void){
+    SymTable_T oSymTable;
+
+    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+
+    /* Not enough memory */
+    if(oSymTable==NULL){
+        return NULL;
+    }
+
+    oSymTable->length=0;
+    if(!SymTable_allocSlots(oSymTable, INITIAL_SLOT_COUNT)){
+        free(oSymTable);
+        return NULL;
+    }
+
+    return oSymTable;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+    size_t index;
+
+    assert(oSymTable!=NULL);
+
+    for(index=0; index<oSymTable->numSlots; index++){
+        if((oSymTable->ctrl[index] & 0x80)==0){
+            free((char*)oSymTable->slots[index].key);
+        }
+    }
+    free(oSymTable->ctrl);
+    free(oSymTable->slots);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable!=NULL);
+    return oSymTable->length;
+}
+
+/* This function rebuilds oSymTable into a fresh slot array, doubling
+the number of slots if the table is at least half full, and otherwise
+keeping the size and just clearing out tombstones. If not enough
+memory is available, then the table is unchanged. */
+static void SymTable_rehash(SymTable_T oSymTable){
+    unsigned char *oldCtrl = oSymTable->ctrl;
+    struct Slot *oldSlots = oSymTable->slots;
+    size_t oldNumSlots = oSymTable->numSlots;
+    size_t newNumSlots = oldNumSlots;
+    size_t index;
+    size_t group;
+    size_t step;
+    unsigned int mask;
+
+    if(oSymTable->length * 2 >= oldNumSlots){
+        /* No room left to double into */
+        if(oldNumSlots > ((size_t)-1) / 2 / sizeof(struct Slot)){
+            return;
+        }
+        newNumSlots = oldNumSlots * 2;
+    }
+
+    if(!SymTable_allocSlots(oSymTable, newNumSlots)){
+        return;
+    }
+
+    /* Every key is known to be distinct, so each binding just goes
+    into the first slot with no binding along its probe sequence. */
+    for(index=0; index<oldNumSlots; index++){
+        if((oldCtrl[index] & 0x80)!=0){
+            continue;
+        }
+        group = SymTable_firstGroup(oSymTable, oldSlots[index].hash);
+        for(step = 1; ; step++){
+            mask = Group_matchAvailable(&oSymTable->ctrl[group]);
+            if(mask!=0){
+                break;
+            }
+            group = SymTable_nextGroup(oSymTable, group, step);
+        }
+        group += Group_lowestBit(mask);
+        oSymTable->ctrl[group] =
+            SymTable_fingerprint(oldSlots[index].hash);
+        oSymTable->slots[group] = oldSlots[index];
+    }
+
+    free(oldCtrl);
+    free(oldSlots);
+}
+
+int SymTable_put(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    size_t uHash;
+    size_t index;
+    char *keyCopy;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    uHash = SymTable_hash(pcKey);
+
+    if(SymTable_find(oSymTable, pcKey, uHash, &index)
+        !=oSymTable->numSlots){
+        return 0;
+    }
+
+    /* Filling an empty slot (rather than reusing a tombstone) moves
+    the table toward its load limit. Rebuild first if the limit would
+    be crossed; if that fails, carry on as long as an empty slot will
+    remain, since lookups rely on meeting one. */
+    if(oSymTable->ctrl[index]==CTRL_EMPTY
+        && (oSymTable->length + oSymTable->numDeleted + 1) * MAX_LOAD_DEN
+        > oSymTable->numSlots * MAX_LOAD_NUM){
+        SymTable_rehash(oSymTable);
+        if(oSymTable->length + oSymTable->numDeleted + 1
+            >= oSymTable->numSlots){
+            return 0;
+        }
+        (void)SymTable_find(oSymTable, pcKey, uHash, &index);
+    }
+
+    keyCopy = (char*)malloc(strlen(pcKey)+1);
+    if(keyCopy==NULL){
+        return 0;
+    }
+    strcpy(keyCopy, pcKey);
+
+    if(oSymTable->ctrl[index]==CTRL_DELETED){
+        oSymTable->numDeleted-=1;
+    }
+    oSymTable->ctrl[index] = SymTable_fingerprint(uHash);
+    oSymTable->slots[index].key = keyCopy;
+    oSymTable->slots[index].value = pvValue;
+    oSymTable->slots[index].hash = uHash;
+    oSymTable->length+=1;
+    return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue){
+    size_t index;
+    const void *oldValue;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    index = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), NULL);
+    if(index==oSymTable->numSlots){
+        return NULL;
+    }
+
+    oldValue = oSymTable->slots[index].value;
+    oSymTable->slots[index].value = pvValue;
+    return (void*)oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    return SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), NULL)
+        != oSymTable->numSlots;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    index = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), NULL);
+    if(index==oSymTable->numSlots){
+        return NULL;
+    }
+    return (void*)oSymTable->slots[index].value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    size_t index;
+    size_t group;
+    const void *removedValue;
+
+    assert(oSymTable!=NULL);
+    assert(pcKey!=NULL);
+
+    index = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), NULL);
+    if(index==oSymTable->numSlots){
+        return NULL;
+    }
+
+    free((char*)oSymTable->slots[index].key);
+    removedValue = oSymTable->slots[index].value;
+    oSymTable->length-=1;
+
+    /* If the group still has an empty slot, no probe ever continued
+    past it, so the slot can simply become empty. Otherwise some key
+    may have been pushed past this group, and a tombstone is needed to
+    keep its probe sequence intact. */
+    group = index & ~(size_t)(GROUP_WIDTH - 1);
+    if(Group_matchByte(&oSymTable->ctrl[group], CTRL_EMPTY)!=0){
+        oSymTable->ctrl[index] = CTRL_EMPTY;
+    }
+    else{
+        oSymTable->ctrl[index] = CTRL_DELETED;
+        oSymTable->numDeleted+=1;
+    }
+
+    return (void*)removedValue;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra){
+    size_t index;
+
+    assert(oSymTable!=NULL);
+    assert(pfApply!=NULL);
+
+    for(index=0; index<oSymTable->numSlots; index++){
+        if((oSymTable->ctrl[index] & 0x80)==0){
+            (*pfApply)(oSymTable->slots[index].key,
+            (void*)oSymTable->slots[index].value, (void*)pvExtra);
+        }
+    }
+}
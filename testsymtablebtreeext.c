@@ -0,0 +1,327 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablebtreeext.c                                             */
+/* Author: Vikram Kakaria                                             */
+/*--------------------------------------------------------------------*/
+
+#include "symtablebtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The state of a walk over bindings that checks their order. */
+
+struct Walk
+{
+   /* The key visited last, or NULL if none has been */
+   const char *pcPrevious;
+
+   /* The number of bindings visited */
+   size_t uCount;
+
+   /* 1 if every key was greater than the one before it */
+   int iOrdered;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Record the visit of the binding whose key is pcKey in the Walk
+   pointed to by pvExtra. pvValue must be pcKey. */
+
+static void visitBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct Walk *psWalk = (struct Walk*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   if ((psWalk->pcPrevious != NULL)
+      && (strcmp(psWalk->pcPrevious, pcKey) >= 0))
+      psWalk->iOrdered = 0;
+   psWalk->pcPrevious = pcKey;
+   psWalk->uCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Initialize *psWalk for a new walk. */
+
+static void startWalk(struct Walk *psWalk)
+{
+   psWalk->pcPrevious = NULL;
+   psWalk->uCount = 0;
+   psWalk->iOrdered = 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Fill the uCount keys of pacKeys with "%06d" renderings of the
+   numbers 0, 2, 4, ..., and shuffle ppcKeys, which points to them. */
+
+static void makeKeys(char (*pacKeys)[16], const char **ppcKeys,
+   int iCount)
+{
+   int i;
+   int iOther;
+   const char *pcSwap;
+
+   for (i = 0; i < iCount; i++)
+   {
+      sprintf(pacKeys[i], "%06d", 2 * i);
+      ppcKeys[i] = pacKeys[i];
+   }
+   for (i = iCount - 1; i > 0; i--)
+   {
+      iOther = rand() % (i + 1);
+      pcSwap = ppcKeys[i];
+      ppcKeys[i] = ppcKeys[iOther];
+      ppcKeys[iOther] = pcSwap;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that SymTable_map visits bindings in order of key, as bindings
+   are added and removed in random order. */
+
+static void testOrder(void)
+{
+   enum {BINDING_COUNT = 50000};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[16];
+   const char **ppcKeys;
+   struct Walk sWalk;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the order of SymTable_map().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = malloc(BINDING_COUNT * sizeof(*pacKeys));
+   ppcKeys = malloc(BINDING_COUNT * sizeof(*ppcKeys));
+   ASSURE((pacKeys != NULL) && (ppcKeys != NULL));
+   makeKeys(pacKeys, ppcKeys, BINDING_COUNT);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+      ASSURE(SymTable_put(oSymTable, ppcKeys[i], ppcKeys[i]));
+
+   startWalk(&sWalk);
+   SymTable_map(oSymTable, visitBinding, &sWalk);
+   ASSURE(sWalk.iOrdered);
+   ASSURE(sWalk.uCount == BINDING_COUNT);
+
+   /* Remove every other key, in random order. */
+   for (i = 0; i < BINDING_COUNT; i += 2)
+      ASSURE(SymTable_remove(oSymTable, ppcKeys[i]) == ppcKeys[i]);
+   for (i = 0; i < BINDING_COUNT; i++)
+      ASSURE(SymTable_contains(oSymTable, ppcKeys[i]) == (i % 2));
+
+   startWalk(&sWalk);
+   SymTable_map(oSymTable, visitBinding, &sWalk);
+   ASSURE(sWalk.iOrdered);
+   ASSURE(sWalk.uCount == BINDING_COUNT / 2);
+
+   /* Emptying the table leaves it usable. */
+   for (i = 1; i < BINDING_COUNT; i += 2)
+      ASSURE(SymTable_remove(oSymTable, ppcKeys[i]) == ppcKeys[i]);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   startWalk(&sWalk);
+   SymTable_map(oSymTable, visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == 0);
+   ASSURE(SymTable_put(oSymTable, ppcKeys[0], ppcKeys[0]));
+   ASSURE(SymTable_get(oSymTable, ppcKeys[0]) == ppcKeys[0]);
+
+   SymTable_free(oSymTable);
+   free(ppcKeys);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_lowerBound(), SymTable_mapRange() and
+   SymTable_mapPrefix() on a table whose keys are "%06d" renderings of
+   the even numbers below 2 * BINDING_COUNT. */
+
+static void testRanges(void)
+{
+   enum {BINDING_COUNT = 20000};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[16];
+   const char **ppcKeys;
+   struct Walk sWalk;
+   const char *pcKey;
+   void *pvValue;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_lowerBound(), SymTable_mapRange() and\n");
+   printf("SymTable_mapPrefix().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = malloc(BINDING_COUNT * sizeof(*pacKeys));
+   ppcKeys = malloc(BINDING_COUNT * sizeof(*ppcKeys));
+   ASSURE((pacKeys != NULL) && (ppcKeys != NULL));
+   makeKeys(pacKeys, ppcKeys, BINDING_COUNT);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_lowerBound(oSymTable, "", NULL) == NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+      ASSURE(SymTable_put(oSymTable, ppcKeys[i], ppcKeys[i]));
+
+   /* Present keys are their own lower bounds; absent ones have the
+      next even number. */
+   pcKey = SymTable_lowerBound(oSymTable, "001234", &pvValue);
+   ASSURE((pcKey != NULL) && (strcmp(pcKey, "001234") == 0));
+   ASSURE((pvValue != NULL) && (strcmp((char*)pvValue, "001234") == 0));
+   pcKey = SymTable_lowerBound(oSymTable, "001235", NULL);
+   ASSURE((pcKey != NULL) && (strcmp(pcKey, "001236") == 0));
+   pcKey = SymTable_lowerBound(oSymTable, "0012359", NULL);
+   ASSURE((pcKey != NULL) && (strcmp(pcKey, "001236") == 0));
+   pcKey = SymTable_lowerBound(oSymTable, "", NULL);
+   ASSURE((pcKey != NULL) && (strcmp(pcKey, "000000") == 0));
+   pvValue = NULL;
+   pcKey = SymTable_lowerBound(oSymTable, "039999", &pvValue);
+   ASSURE((pcKey == NULL) && (pvValue == NULL));
+
+   /* Ranges are closed below and open above. */
+   startWalk(&sWalk);
+   SymTable_mapRange(oSymTable, "001000", "002000", visitBinding,
+      &sWalk);
+   ASSURE(sWalk.iOrdered && (sWalk.uCount == 500));
+   ASSURE(strcmp(sWalk.pcPrevious, "001998") == 0);
+   startWalk(&sWalk);
+   SymTable_mapRange(oSymTable, "001001", "001999", visitBinding,
+      &sWalk);
+   ASSURE(sWalk.uCount == 499);
+   startWalk(&sWalk);
+   SymTable_mapRange(oSymTable, "002000", "001000", visitBinding,
+      &sWalk);
+   ASSURE(sWalk.uCount == 0);
+   startWalk(&sWalk);
+   SymTable_mapRange(oSymTable, NULL, "000100", visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == 50);
+   startWalk(&sWalk);
+   SymTable_mapRange(oSymTable, "039900", NULL, visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == 50);
+   startWalk(&sWalk);
+   SymTable_mapRange(oSymTable, NULL, NULL, visitBinding, &sWalk);
+   ASSURE(sWalk.iOrdered && (sWalk.uCount == BINDING_COUNT));
+
+   /* Prefixes. */
+   startWalk(&sWalk);
+   SymTable_mapPrefix(oSymTable, "0012", visitBinding, &sWalk);
+   ASSURE(sWalk.iOrdered && (sWalk.uCount == 50));
+   startWalk(&sWalk);
+   SymTable_mapPrefix(oSymTable, "001234", visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == 1);
+   startWalk(&sWalk);
+   SymTable_mapPrefix(oSymTable, "001235", visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == 0);
+   startWalk(&sWalk);
+   SymTable_mapPrefix(oSymTable, "", visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == BINDING_COUNT);
+   startWalk(&sWalk);
+   SymTable_mapPrefix(oSymTable, "1", visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == 0);
+
+   SymTable_free(oSymTable);
+   free(ppcKeys);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test ordered access to keys that share prefixes longer than the
+   part of a key that a node keeps in place, and keys that are
+   prefixes of one another. */
+
+static void testLongKeys(void)
+{
+   static const char *apcKeys[] = {
+      "namespace::alpha", "namespace::alphabet", "namespace::beta",
+      "namespace::b", "namespace", "namespace:", "names",
+      "namespace::beta::gamma", "namespaces", ""
+   };
+   enum {KEY_COUNT = sizeof(apcKeys) / sizeof(apcKeys[0])};
+
+   SymTable_T oSymTable;
+   struct Walk sWalk;
+   const char *pcKey;
+   size_t u;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing ordered access to long keys.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (u = 0; u < KEY_COUNT; u++)
+      ASSURE(SymTable_put(oSymTable, apcKeys[u], apcKeys[u]));
+   for (u = 0; u < KEY_COUNT; u++)
+      ASSURE(SymTable_get(oSymTable, apcKeys[u]) == apcKeys[u]);
+
+   startWalk(&sWalk);
+   SymTable_map(oSymTable, visitBinding, &sWalk);
+   ASSURE(sWalk.iOrdered && (sWalk.uCount == KEY_COUNT));
+
+   startWalk(&sWalk);
+   SymTable_mapPrefix(oSymTable, "namespace::b", visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == 3);
+   startWalk(&sWalk);
+   SymTable_mapPrefix(oSymTable, "namespace", visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == 8);
+
+   pcKey = SymTable_lowerBound(oSymTable, "namespace::alpha!", NULL);
+   ASSURE((pcKey != NULL) && (strcmp(pcKey, "namespace::alphabet") == 0));
+   pcKey = SymTable_lowerBound(oSymTable, "namespace::c", NULL);
+   ASSURE((pcKey != NULL) && (strcmp(pcKey, "namespaces") == 0));
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the extensions to the SymTable ADT that the B-tree
+   implementation provides. Write the output of the tests to stdout.
+   Return 0. */
+
+int main(void)
+{
+   testOrder();
+   testRanges();
+   testLongKeys();
+
+   printf("------------------------------------------------------\n");
+   printf("End of testsymtablebtreeext.\n");
+   return 0;
+}
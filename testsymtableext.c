@@ -0,0 +1,1053 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableext.c                                                  */
+/* Author: Vikram Kakaria                                             */
+/*--------------------------------------------------------------------*/
+
+#include "symtablehash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Increment the count of bindings pointed to by pvExtra. pcKey and
+   pvValue are unused. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   (void)pvValue;
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bindings that SymTable_map visits in
+   oSymTable. */
+
+static size_t countBindings(SymTable_T oSymTable)
+{
+   size_t uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   return uCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iCount bindings into oSymTable, each of whose key is the decimal
+   representation of a number from iFirst to iFirst+iCount-1 and whose
+   value is the constant string "value". */
+
+static void putRange(SymTable_T oSymTable, int iFirst, int iCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+   int iSuccessful;
+
+   for (i = iFirst; i < iFirst + iCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, "value");
+      ASSURE(iSuccessful);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the bindings that putRange(oSymTable, iFirst, iCount)
+   added. */
+
+static void removeRange(SymTable_T oSymTable, int iFirst, int iCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+   char *pcValue;
+
+   for (i = iFirst; i < iFirst + iCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, "value") == 0));
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if every binding that putRange(oSymTable, iFirst, iCount)
+   added is present in oSymTable, or 0 otherwise. */
+
+static int containsRange(SymTable_T oSymTable, int iFirst, int iCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+
+   for (i = iFirst; i < iFirst + iCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (! SymTable_contains(oSymTable, acKey))
+         return 0;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that a SymTable object stays intact while it shrinks, both by
+   itself and through SymTable_shrinkToFit(). */
+
+static void testShrink(void)
+{
+   enum {BINDING_COUNT = 100000, KEPT_COUNT = 100};
+
+   SymTable_T oSymTable;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_shrinkToFit() and automatic shrinking.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Grow the table, then drain most of it so that it shrinks as
+      bindings are removed. */
+   putRange(oSymTable, 0, BINDING_COUNT);
+   removeRange(oSymTable, KEPT_COUNT, BINDING_COUNT - KEPT_COUNT);
+   ASSURE(SymTable_getLength(oSymTable) == KEPT_COUNT);
+   ASSURE(containsRange(oSymTable, 0, KEPT_COUNT));
+   ASSURE(countBindings(oSymTable) == KEPT_COUNT);
+
+   /* Shrink it the rest of the way at once. */
+   SymTable_shrinkToFit(oSymTable);
+   ASSURE(SymTable_getLength(oSymTable) == KEPT_COUNT);
+   ASSURE(containsRange(oSymTable, 0, KEPT_COUNT));
+   ASSURE(countBindings(oSymTable) == KEPT_COUNT);
+   ASSURE(! SymTable_contains(oSymTable, "100"));
+
+   /* The shrunken table must be able to grow again. */
+   putRange(oSymTable, KEPT_COUNT, BINDING_COUNT - KEPT_COUNT);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+   ASSURE(containsRange(oSymTable, 0, BINDING_COUNT));
+
+   /* An empty table can be shrunk and reused. */
+   removeRange(oSymTable, 0, BINDING_COUNT);
+   SymTable_shrinkToFit(oSymTable);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   ASSURE(countBindings(oSymTable) == 0);
+   putRange(oSymTable, 0, KEPT_COUNT);
+   ASSURE(containsRange(oSymTable, 0, KEPT_COUNT));
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newWithCapacity() and SymTable_reserve(). */
+
+static void testReserve(void)
+{
+   enum {BINDING_COUNT = 100000};
+
+   SymTable_T oSymTable;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newWithCapacity() and SymTable_reserve().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithCapacity(BINDING_COUNT);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   putRange(oSymTable, 0, BINDING_COUNT);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+   ASSURE(containsRange(oSymTable, 0, BINDING_COUNT));
+   SymTable_free(oSymTable);
+
+   /* A tiny capacity still gives a usable table. */
+   oSymTable = SymTable_newWithCapacity(0);
+   ASSURE(oSymTable != NULL);
+   putRange(oSymTable, 0, 10);
+   ASSURE(containsRange(oSymTable, 0, 10));
+
+   /* Reserving in a table that already holds bindings keeps them. */
+   iSuccessful = SymTable_reserve(oSymTable, BINDING_COUNT);
+   ASSURE(iSuccessful);
+   ASSURE(containsRange(oSymTable, 0, 10));
+   putRange(oSymTable, 10, BINDING_COUNT - 10);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+   ASSURE(containsRange(oSymTable, 0, BINDING_COUNT));
+   ASSURE(countBindings(oSymTable) == BINDING_COUNT);
+
+   /* Reserving less than the current size changes nothing. */
+   iSuccessful = SymTable_reserve(oSymTable, 10);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+
+   /* An impossible reservation fails and leaves the table alone. */
+   iSuccessful = SymTable_reserve(oSymTable, (size_t)-1);
+   ASSURE(! iSuccessful);
+   ASSURE(containsRange(oSymTable, 0, BINDING_COUNT));
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object that uses the hash function named by
+   ePolicy, with keys that share a long prefix and differ in length
+   around multiples of 8 characters. */
+
+static void testHashPolicy(SymTable_HashPolicy_T ePolicy)
+{
+   enum {BINDING_COUNT = 20000, MAX_KEY_LENGTH = 64};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+   int iSuccessful;
+   char *pcValue;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newWithHash() with policy %d.\n",
+      (int)ePolicy);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithHash(ePolicy, 0);
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "_ZN9namespace5Class6method%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, "value");
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+
+   /* The empty key, and keys that are prefixes of one another. */
+   iSuccessful = SymTable_put(oSymTable, "", "empty");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "_ZN9namespace", "prefix");
+   ASSURE(iSuccessful);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "_ZN9namespace5Class6method%d", i);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, "value") == 0));
+   }
+   pcValue = (char*)SymTable_get(oSymTable, "");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "empty") == 0));
+   pcValue = (char*)SymTable_get(oSymTable, "_ZN9namespace");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "prefix") == 0));
+   ASSURE(! SymTable_contains(oSymTable, "_ZN9namespace5"));
+   ASSURE(! SymTable_contains(oSymTable, "_ZN9namespace5Class6method"));
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "_ZN9namespace5Class6method%d", i);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE(pcValue != NULL);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that the null-terminated key pcKey is the string pvExtra
+   points to, when pvValue is "match". pvExtra must be a (const char**)
+   pointer. */
+
+static void checkStoredKey(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   if (strcmp((char*)pvValue, "match") == 0)
+      ASSURE(strcmp(pcKey, *(const char**)pvExtra) == 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_putn(), SymTable_replacen(), SymTable_containsn(),
+   SymTable_getn() and SymTable_removen(), using keys that are slices
+   of a larger buffer. */
+
+static void testLengthKeys(void)
+{
+   SymTable_T oSymTable;
+   const char *pcText = "alphabetagamma";
+   const char *pcExpected;
+   int iSuccessful;
+   char *pcValue;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the length-aware key functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* "alpha", "beta" and "gamma" as slices of pcText. */
+   iSuccessful = SymTable_putn(oSymTable, pcText, 5, "alpha");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putn(oSymTable, pcText + 5, 4, "beta");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putn(oSymTable, pcText + 9, 5, "gamma");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putn(oSymTable, pcText + 5, 4, "again");
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+
+   /* Slices and strings name the same keys. */
+   ASSURE(SymTable_contains(oSymTable, "alpha"));
+   ASSURE(SymTable_contains(oSymTable, "beta"));
+   ASSURE(SymTable_containsn(oSymTable, "gamma!", 5));
+   ASSURE(! SymTable_contains(oSymTable, "alphabetagamma"));
+   pcValue = (char*)SymTable_getn(oSymTable, "betamax", 4);
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "beta") == 0));
+   pcValue = (char*)SymTable_get(oSymTable, "gamma");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "gamma") == 0));
+
+   /* A prefix of a key is a different key, including the empty
+      one. */
+   ASSURE(! SymTable_containsn(oSymTable, pcText, 4));
+   ASSURE(! SymTable_containsn(oSymTable, pcText, 0));
+   iSuccessful = SymTable_putn(oSymTable, pcText, 0, "empty");
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_contains(oSymTable, ""));
+
+   pcValue = (char*)SymTable_replacen(oSymTable, pcText, 5, "match");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "alpha") == 0));
+   pcValue = (char*)SymTable_replacen(oSymTable, pcText, 6, "match");
+   ASSURE(pcValue == NULL);
+
+   /* The stored key is a null-terminated copy of the slice. */
+   pcExpected = "alpha";
+   SymTable_map(oSymTable, checkStoredKey, &pcExpected);
+
+   pcValue = (char*)SymTable_removen(oSymTable, pcText + 9, 5);
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "gamma") == 0));
+   pcValue = (char*)SymTable_removen(oSymTable, pcText + 9, 5);
+   ASSURE(pcValue == NULL);
+   pcValue = (char*)SymTable_remove(oSymTable, "beta");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "beta") == 0));
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_getBatch(), with batches of several sizes, keys that
+   are absent, and a table that is in the middle of expanding. */
+
+static void testGetBatch(void)
+{
+   /* The table expands at its 4097th binding, and has moved fewer
+      than half of its old buckets by its 4300th. */
+   enum {BINDING_COUNT = 4300, KEY_COUNT = 2 * BINDING_COUNT,
+      MAX_KEY_LENGTH = 16};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   const char **ppcKeys;
+   void **ppvValues;
+   int i;
+   int iCount;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_getBatch().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = malloc(KEY_COUNT * sizeof(*pacKeys));
+   ppcKeys = malloc(KEY_COUNT * sizeof(*ppcKeys));
+   ppvValues = malloc(KEY_COUNT * sizeof(*ppvValues));
+   ASSURE((pacKeys != NULL) && (ppcKeys != NULL)
+      && (ppvValues != NULL));
+
+   /* Every other key is absent. Odd keys are looked up too. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      ppcKeys[i] = pacKeys[i];
+   }
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i += 2)
+      SymTable_put(oSymTable, ppcKeys[i], ppcKeys[i]);
+
+   /* The table is still moving buckets, so lookups hit both bucket
+      arrays. */
+   for (iCount = 0; iCount <= 40; iCount += 7)
+   {
+      SymTable_getBatch(oSymTable, ppcKeys, (size_t)iCount, ppvValues);
+      for (i = 0; i < iCount; i++)
+         ASSURE(ppvValues[i] == SymTable_get(oSymTable, ppcKeys[i]));
+   }
+
+   SymTable_getBatch(oSymTable, ppcKeys, KEY_COUNT, ppvValues);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      if (i % 2 == 0)
+         ASSURE(ppvValues[i] == ppcKeys[i]);
+      else
+         ASSURE(ppvValues[i] == NULL);
+   }
+
+   SymTable_free(oSymTable);
+   free(ppvValues);
+   free(ppcKeys);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_putBatch(), with keys that are already present, keys
+   that repeat within a batch, and keys too long to share a chunk. */
+
+static void testPutBatch(void)
+{
+   enum {BINDING_COUNT = 20000, MAX_KEY_LENGTH = 512};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   const char **ppcKeys;
+   int *piResults;
+   size_t uAdded;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_putBatch().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = malloc(BINDING_COUNT * sizeof(*pacKeys));
+   ppcKeys = malloc(BINDING_COUNT * sizeof(*ppcKeys));
+   piResults = malloc(BINDING_COUNT * sizeof(*piResults));
+   ASSURE((pacKeys != NULL) && (ppcKeys != NULL)
+      && (piResults != NULL));
+
+   /* Every hundredth key is long. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      if (i % 100 == 0)
+      {
+         memset(pacKeys[i], 'x', MAX_KEY_LENGTH - 16);
+         sprintf(pacKeys[i] + MAX_KEY_LENGTH - 16, "%d", i);
+      }
+      else
+         sprintf(pacKeys[i], "%d", i);
+      ppcKeys[i] = pacKeys[i];
+   }
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* An empty batch does nothing. */
+   uAdded = SymTable_putBatch(oSymTable, NULL, NULL, 0, NULL);
+   ASSURE(uAdded == 0);
+
+   /* The first half, into the empty table. */
+   uAdded = SymTable_putBatch(oSymTable, ppcKeys,
+      (const void**)ppcKeys, BINDING_COUNT / 2, piResults);
+   ASSURE(uAdded == BINDING_COUNT / 2);
+   for (i = 0; i < BINDING_COUNT / 2; i++)
+      ASSURE(piResults[i]);
+
+   /* All of them, so that the first half is already present. */
+   uAdded = SymTable_putBatch(oSymTable, ppcKeys,
+      (const void**)ppcKeys, BINDING_COUNT, piResults);
+   ASSURE(uAdded == BINDING_COUNT - BINDING_COUNT / 2);
+   for (i = 0; i < BINDING_COUNT; i++)
+      ASSURE(piResults[i] == (i >= BINDING_COUNT / 2));
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+   ASSURE(countBindings(oSymTable) == BINDING_COUNT);
+   for (i = 0; i < BINDING_COUNT; i++)
+      ASSURE(SymTable_get(oSymTable, ppcKeys[i]) == ppcKeys[i]);
+   SymTable_free(oSymTable);
+
+   /* A key that repeats within a batch is added only once. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ppcKeys[1] = ppcKeys[0];
+   uAdded = SymTable_putBatch(oSymTable, ppcKeys,
+      (const void**)ppcKeys, 3, piResults);
+   ASSURE(uAdded == 2);
+   ASSURE(piResults[0] && ! piResults[1] && piResults[2]);
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+
+   /* The table still behaves once a batch has been put. */
+   uAdded = SymTable_putBatch(oSymTable, ppcKeys + 2,
+      (const void**)ppcKeys + 2, BINDING_COUNT - 2, NULL);
+   ASSURE(uAdded == BINDING_COUNT - 3);
+   for (i = 2; i < BINDING_COUNT; i++)
+      ASSURE(SymTable_remove(oSymTable, ppcKeys[i]) == ppcKeys[i]);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   SymTable_free(oSymTable);
+
+   free(piResults);
+   free(ppcKeys);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_find() and the functions that take the handles it
+   returns, including handles that are kept while the table grows and
+   shrinks. */
+
+static void testHandles(void)
+{
+   enum {BINDING_COUNT = 50000, MAX_KEY_LENGTH = 16};
+
+   SymTable_T oSymTable;
+   SymTable_Binding_T oBinding;
+   SymTable_Binding_T oKept;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_find() and binding handles.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   ASSURE(SymTable_find(oSymTable, "0") == NULL);
+   putRange(oSymTable, 0, 10);
+   ASSURE(SymTable_find(oSymTable, "10") == NULL);
+   ASSURE(SymTable_findn(oSymTable, "10", 1) != NULL);
+
+   oKept = SymTable_find(oSymTable, "7");
+   ASSURE(oKept != NULL);
+   ASSURE(strcmp(SymTable_keyAt(oSymTable, oKept), "7") == 0);
+   pcValue = (char*)SymTable_getAt(oSymTable, oKept);
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "value") == 0));
+   pcValue = (char*)SymTable_replaceAt(oSymTable, oKept, "kept");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "value") == 0));
+   pcValue = (char*)SymTable_get(oSymTable, "7");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "kept") == 0));
+
+   /* The handle outlives expansions. */
+   putRange(oSymTable, 10, BINDING_COUNT - 10);
+   ASSURE(SymTable_find(oSymTable, "7") == oKept);
+   pcValue = (char*)SymTable_getAt(oSymTable, oKept);
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "kept") == 0));
+
+   /* Remove every other binding through its handle. */
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      oBinding = SymTable_find(oSymTable, acKey);
+      ASSURE(oBinding != NULL);
+      pcValue = (char*)SymTable_removeAt(oSymTable, oBinding);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, "value") == 0));
+      ASSURE(SymTable_find(oSymTable, acKey) == NULL);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT / 2);
+   ASSURE(countBindings(oSymTable) == BINDING_COUNT / 2);
+   for (i = 1; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+   }
+
+   pcValue = (char*)SymTable_removeAt(oSymTable, oKept);
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "kept") == 0));
+   ASSURE(! SymTable_contains(oSymTable, "7"));
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_getOrPut() and SymTable_putOrReplace(). */
+
+static void testUpsert(void)
+{
+   enum {BINDING_COUNT = 20000, MAX_KEY_LENGTH = 16};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   void *pvValue;
+   char *pcValue;
+   int iResult;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_getOrPut() and SymTable_putOrReplace().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   iResult = SymTable_getOrPut(oSymTable, "x", "first", &pvValue);
+   ASSURE(iResult == 1);
+   ASSURE(strcmp((char*)pvValue, "first") == 0);
+   iResult = SymTable_getOrPut(oSymTable, "x", "second", &pvValue);
+   ASSURE(iResult == 0);
+   ASSURE(strcmp((char*)pvValue, "first") == 0);
+   iResult = SymTable_getOrPut(oSymTable, "x", "third", NULL);
+   ASSURE(iResult == 0);
+   pcValue = (char*)SymTable_get(oSymTable, "x");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "first") == 0));
+
+   pvValue = "untouched";
+   iResult = SymTable_putOrReplace(oSymTable, "y", "first", &pvValue);
+   ASSURE(iResult == 1);
+   ASSURE(strcmp((char*)pvValue, "untouched") == 0);
+   iResult = SymTable_putOrReplace(oSymTable, "y", "second", &pvValue);
+   ASSURE(iResult == 0);
+   ASSURE(strcmp((char*)pvValue, "first") == 0);
+   iResult = SymTable_putOrReplace(oSymTable, "x", "second", NULL);
+   ASSURE(iResult == 0);
+   pcValue = (char*)SymTable_get(oSymTable, "x");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "second") == 0));
+   pcValue = (char*)SymTable_get(oSymTable, "y");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "second") == 0));
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+
+   /* Many keys, each defined and then redefined, as the table
+      expands. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iResult = SymTable_putOrReplace(oSymTable, acKey, "value", NULL);
+      ASSURE(iResult == 1);
+      iResult = SymTable_getOrPut(oSymTable, acKey, "other", NULL);
+      ASSURE(iResult == 0);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT + 2);
+   ASSURE(containsRange(oSymTable, 0, BINDING_COUNT));
+   removeRange(oSymTable, 0, BINDING_COUNT);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects that start small and outgrow it, both one
+   binding at a time and through SymTable_reserve(), and that become
+   small again through SymTable_shrinkToFit(). */
+
+static void testSmallTables(void)
+{
+   enum {TABLE_COUNT = 1000, SMALL_COUNT = 8, BINDING_COUNT = 1000};
+
+   SymTable_T aoSymTables[TABLE_COUNT];
+   SymTable_T oSymTable;
+   SymTable_Binding_T oKept;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing small SymTable objects.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Many tables, each with a few bindings. */
+   for (i = 0; i < TABLE_COUNT; i++)
+   {
+      aoSymTables[i] = SymTable_new();
+      ASSURE(aoSymTables[i] != NULL);
+      putRange(aoSymTables[i], i, i % (SMALL_COUNT + 1));
+   }
+   for (i = 0; i < TABLE_COUNT; i++)
+   {
+      ASSURE(SymTable_getLength(aoSymTables[i])
+         == (size_t)(i % (SMALL_COUNT + 1)));
+      ASSURE(containsRange(aoSymTables[i], i, i % (SMALL_COUNT + 1)));
+      ASSURE(! SymTable_contains(aoSymTables[i], "-1"));
+      SymTable_free(aoSymTables[i]);
+   }
+
+   /* A table that outgrows being small keeps its bindings and
+      handles, wherever it is in the resize. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   putRange(oSymTable, 0, SMALL_COUNT);
+   oKept = SymTable_find(oSymTable, "3");
+   ASSURE(oKept != NULL);
+   for (i = SMALL_COUNT; i < BINDING_COUNT; i++)
+   {
+      putRange(oSymTable, i, 1);
+      ASSURE(containsRange(oSymTable, 0, i + 1));
+      ASSURE(SymTable_find(oSymTable, "3") == oKept);
+   }
+   ASSURE(countBindings(oSymTable) == BINDING_COUNT);
+
+   /* Shrinking it to fit makes it small again, and it can still
+      grow afterwards. */
+   removeRange(oSymTable, SMALL_COUNT, BINDING_COUNT - SMALL_COUNT);
+   SymTable_shrinkToFit(oSymTable);
+   ASSURE(containsRange(oSymTable, 0, SMALL_COUNT));
+   ASSURE(countBindings(oSymTable) == SMALL_COUNT);
+   ASSURE(SymTable_find(oSymTable, "3") == oKept);
+   putRange(oSymTable, SMALL_COUNT, BINDING_COUNT - SMALL_COUNT);
+   ASSURE(containsRange(oSymTable, 0, BINDING_COUNT));
+   SymTable_free(oSymTable);
+
+   /* Reserving room for a small number of bindings keeps a table
+      small; reserving more makes it a hash table at once. */
+   oSymTable = SymTable_newWithCapacity(SMALL_COUNT);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_reserve(oSymTable, SMALL_COUNT));
+   putRange(oSymTable, 0, SMALL_COUNT);
+   ASSURE(SymTable_reserve(oSymTable, BINDING_COUNT));
+   ASSURE(containsRange(oSymTable, 0, SMALL_COUNT));
+   putRange(oSymTable, SMALL_COUNT, BINDING_COUNT - SMALL_COUNT);
+   ASSURE(containsRange(oSymTable, 0, BINDING_COUNT));
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object whose bindings have short and long keys, in
+   and out of the storage a table has for its first few short keys.
+   Write the output of the tests to stdout. */
+
+static void testInlineBindings(void)
+{
+   enum {INLINE_COUNT = 8, ROUND_COUNT = 50, BINDING_COUNT = 100};
+
+   static const char acLong[] = "a key too long to be stored inline";
+   SymTable_T oSymTable;
+   SymTable_Binding_T aoKept[INLINE_COUNT];
+   char acKey[sizeof(acLong) + 16];
+   char *pcValue;
+   int i;
+   int iRound;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable bindings with short and long keys.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Removing and putting keys over and over, short ones and long
+      ones alternately, reuses whatever storage the removed ones
+      had. */
+   for (iRound = 0; iRound < ROUND_COUNT; iRound++)
+   {
+      for (i = 0; i < INLINE_COUNT; i++)
+      {
+         if ((i + iRound) % 2 == 0)
+            sprintf(acKey, "%d", i);
+         else
+            sprintf(acKey, "%s %d", acLong, i);
+         ASSURE(SymTable_put(oSymTable, acKey, "value"));
+      }
+      ASSURE(SymTable_getLength(oSymTable) == INLINE_COUNT);
+      ASSURE(countBindings(oSymTable) == INLINE_COUNT);
+      for (i = 0; i < INLINE_COUNT; i++)
+      {
+         if ((i + iRound) % 2 == 0)
+            sprintf(acKey, "%d", i);
+         else
+            sprintf(acKey, "%s %d", acLong, i);
+         pcValue = (char*)SymTable_remove(oSymTable, acKey);
+         ASSURE((pcValue != NULL) && (strcmp(pcValue, "value") == 0));
+      }
+      ASSURE(SymTable_getLength(oSymTable) == 0);
+   }
+
+   /* Keys that fill the storage exactly, terminating null character
+      included, and keys one character longer, keep their bytes. */
+   ASSURE(SymTable_put(oSymTable, "fifteen-chars-1", "15"));
+   ASSURE(SymTable_put(oSymTable, "sixteen-chars-12", "16"));
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "fifteen-chars-1"),
+      "15") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "sixteen-chars-12"),
+      "16") == 0);
+   ASSURE(strcmp(SymTable_keyAt(oSymTable, SymTable_find(oSymTable,
+      "sixteen-chars-12")), "sixteen-chars-12") == 0);
+   ASSURE(SymTable_remove(oSymTable, "fifteen-chars-1") != NULL);
+   ASSURE(SymTable_remove(oSymTable, "sixteen-chars-12") != NULL);
+
+   /* Bindings stored with the table keep their handles as the table
+      grows and shrinks around them. */
+   putRange(oSymTable, 0, INLINE_COUNT);
+   for (i = 0; i < INLINE_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      aoKept[i] = SymTable_find(oSymTable, acKey);
+      ASSURE(aoKept[i] != NULL);
+   }
+   putRange(oSymTable, INLINE_COUNT, BINDING_COUNT - INLINE_COUNT);
+   ASSURE(containsRange(oSymTable, 0, BINDING_COUNT));
+   removeRange(oSymTable, INLINE_COUNT, BINDING_COUNT - INLINE_COUNT);
+   SymTable_shrinkToFit(oSymTable);
+   for (i = 0; i < INLINE_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_find(oSymTable, acKey) == aoKept[i]);
+      ASSURE(strcmp(SymTable_keyAt(oSymTable, aoKept[i]), acKey)
+         == 0);
+   }
+
+   /* A slot freed by a removal is used by the next short key. */
+   ASSURE(SymTable_removeAt(oSymTable, aoKept[2]) != NULL);
+   ASSURE(SymTable_put(oSymTable, "new", "value"));
+   ASSURE(SymTable_contains(oSymTable, "new"));
+   ASSURE(! SymTable_contains(oSymTable, "2"));
+   ASSURE(countBindings(oSymTable) == INLINE_COUNT);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_iterBegin(), SymTable_iterNext() and
+   SymTable_iterEnd() on tables that are small, that are hash tables,
+   and that are in the middle of a resize. Write the output of the
+   tests to stdout. */
+
+static void testIterators(void)
+{
+   /* As in testGetBatch, the largest table is still moving its old
+      buckets when it is walked. */
+   enum {SIZE_COUNT = 5, MAX_BINDING_COUNT = 4300};
+
+   static const int aiSizes[SIZE_COUNT] = {0, 1, 8, 100,
+      MAX_BINDING_COUNT};
+   SymTable_T oSymTable;
+   SymTable_Binding_T oBinding;
+   char *pcSeen;
+   size_t uCount;
+   int iSize;
+   int iKey;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_iterBegin() and SymTable_iterNext().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   pcSeen = (char*)malloc(MAX_BINDING_COUNT);
+   ASSURE(pcSeen != NULL);
+
+   for (iSize = 0; iSize < SIZE_COUNT; iSize++)
+   {
+      oSymTable = SymTable_new();
+      ASSURE(oSymTable != NULL);
+      putRange(oSymTable, 0, aiSizes[iSize]);
+
+      /* Every binding is visited once, and values can be replaced
+         along the way. */
+      memset(pcSeen, 0, MAX_BINDING_COUNT);
+      uCount = 0;
+      for (oBinding = SymTable_iterBegin(oSymTable);
+         oBinding != SymTable_iterEnd(oSymTable);
+         oBinding = SymTable_iterNext(oSymTable, oBinding))
+      {
+         iKey = atoi(SymTable_keyAt(oSymTable, oBinding));
+         ASSURE((iKey >= 0) && (iKey < aiSizes[iSize]));
+         ASSURE(! pcSeen[iKey]);
+         pcSeen[iKey] = 1;
+         ASSURE(strcmp((char*)SymTable_getAt(oSymTable, oBinding),
+            "value") == 0);
+         SymTable_replaceAt(oSymTable, oBinding, "walked");
+         uCount++;
+      }
+      ASSURE(uCount == (size_t)aiSizes[iSize]);
+      ASSURE(uCount == countBindings(oSymTable));
+      for (i = 0; i < aiSizes[iSize]; i++)
+         ASSURE(pcSeen[i]);
+
+      /* A search can stop at the binding it wants. */
+      if (aiSizes[iSize] > 0)
+      {
+         uCount = 0;
+         for (oBinding = SymTable_iterBegin(oSymTable);
+            oBinding != SymTable_iterEnd(oSymTable);
+            oBinding = SymTable_iterNext(oSymTable, oBinding))
+         {
+            uCount++;
+            if (strcmp(SymTable_keyAt(oSymTable, oBinding), "0") == 0)
+               break;
+         }
+         ASSURE(oBinding == SymTable_find(oSymTable, "0"));
+         ASSURE(uCount <= (size_t)aiSizes[iSize]);
+         ASSURE(strcmp((char*)SymTable_getAt(oSymTable, oBinding),
+            "walked") == 0);
+      }
+
+      SymTable_free(oSymTable);
+   }
+
+   free(pcSeen);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* What the bindings one thread of SymTable_mapParallel visits add up
+   to. */
+
+struct Tally
+{
+   /* The number of bindings visited */
+   size_t uCount;
+
+   /* The sum of their keys, read as decimal numbers */
+   long lKeySum;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Add the binding whose key is pcKey to the Tally pointed to by
+   pvExtra. pvValue is unused. */
+
+static void tallyBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct Tally *psTally = (struct Tally*)pvExtra;
+
+   (void)pvValue;
+   psTally->uCount++;
+   psTally->lKeySum += atol(pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add the Tally pointed to by pvExtra to the one pointed to by
+   pvResult. */
+
+static void addTally(void *pvResult, void *pvExtra)
+{
+   struct Tally *psResult = (struct Tally*)pvResult;
+   struct Tally *psTally = (struct Tally*)pvExtra;
+
+   psResult->uCount += psTally->uCount;
+   psResult->lKeySum += psTally->lKeySum;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_mapParallel() on tables large enough for it to start
+   threads, and on tables too small for it to. Write the output of the
+   tests to stdout. */
+
+static void testMapParallel(void)
+{
+   /* The 4300-binding table is in the middle of a resize, as in
+      testGetBatch. */
+   enum {SIZE_COUNT = 4, MAX_THREAD_COUNT = 8};
+
+   static const int aiSizes[SIZE_COUNT] = {0, 5, 4300, 200000};
+   static const size_t auThreadCounts[] = {1, 3, MAX_THREAD_COUNT};
+   SymTable_T oSymTable;
+   struct Tally asTallies[MAX_THREAD_COUNT];
+   void *apvExtras[MAX_THREAD_COUNT];
+   struct Tally sTotal;
+   size_t uThreads;
+   int iSize;
+   size_t u;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_mapParallel().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   for (u = 0; u < MAX_THREAD_COUNT; u++)
+      apvExtras[u] = &asTallies[u];
+
+   for (iSize = 0; iSize < SIZE_COUNT; iSize++)
+   {
+      oSymTable = SymTable_new();
+      ASSURE(oSymTable != NULL);
+      putRange(oSymTable, 0, aiSizes[iSize]);
+
+      for (uThreads = 0; uThreads < sizeof(auThreadCounts)
+         / sizeof(auThreadCounts[0]); uThreads++)
+      {
+         memset(asTallies, 0, sizeof(asTallies));
+         sTotal.uCount = 0;
+         sTotal.lKeySum = 0;
+         SymTable_mapParallel(oSymTable, auThreadCounts[uThreads],
+            tallyBinding, apvExtras, addTally, &sTotal);
+
+         /* Each binding is visited once, by one of the threads. */
+         ASSURE(sTotal.uCount == (size_t)aiSizes[iSize]);
+         ASSURE(sTotal.lKeySum
+            == (long)aiSizes[iSize] * (aiSizes[iSize] - 1) / 2);
+         for (u = auThreadCounts[uThreads]; u < MAX_THREAD_COUNT; u++)
+            ASSURE(asTallies[u].uCount == 0);
+      }
+
+      /* Without a reducer, the results stay in the accumulators. */
+      memset(asTallies, 0, sizeof(asTallies));
+      SymTable_mapParallel(oSymTable, MAX_THREAD_COUNT, tallyBinding,
+         apvExtras, NULL, NULL);
+      sTotal.uCount = 0;
+      sTotal.lKeySum = 0;
+      for (u = 0; u < MAX_THREAD_COUNT; u++)
+         addTally(&sTotal, &asTallies[u]);
+      ASSURE(sTotal.uCount == (size_t)aiSizes[iSize]);
+
+      SymTable_free(oSymTable);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the extensions to the SymTable ADT that the hash table
+   implementation provides. Write the output of the tests to stdout.
+   Return 0. */
+
+int main(void)
+{
+   testShrink();
+   testReserve();
+   testHashPolicy(SYMTABLE_HASH_CLASSIC);
+   testHashPolicy(SYMTABLE_HASH_WIDE);
+   testLengthKeys();
+   testGetBatch();
+   testPutBatch();
+   testHandles();
+   testUpsert();
+   testSmallTables();
+   testInlineBindings();
+   testIterators();
+   testMapParallel();
+
+   printf("------------------------------------------------------\n");
+   printf("End of testsymtableext.\n");
+   return 0;
+}
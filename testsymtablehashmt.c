@@ -0,0 +1,308 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablehashmt.c                                               */
+/* Author: Vikram Kakaria                                             */
+/*--------------------------------------------------------------------*/
+
+#include "symtablehash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+enum {THREAD_COUNT = 4, OWN_COUNT = 40000, SHARED_COUNT = 20000,
+   KEEP_INTERVAL = 8, MAP_INTERVAL = 10000, CHURN_ROUNDS = 4,
+   CHURN_COUNT = 20000, MAX_KEY_LENGTH = 32};
+
+/*--------------------------------------------------------------------*/
+
+/* The work of one thread, and what it found. */
+
+struct Worker
+{
+   /* The table all threads share */
+   SymTable_T oSymTable;
+
+   /* The number of this thread, from 0 */
+   int iNumber;
+
+   /* The number of shared keys this thread added */
+   size_t uSharedAdded;
+
+   /* The number of shared keys this thread removed */
+   size_t uSharedRemoved;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. Threads may call it at once, so each
+   message is written by a single call. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Increment the count of bindings pointed to by pvExtra. pcKey and
+   pvValue are unused. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   (void)pvValue;
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add the count of bindings pointed to by pvExtra to the one pointed
+   to by pvResult. */
+
+static void addCount(void *pvResult, void *pvExtra)
+{
+   *(size_t*)pvResult += *(size_t*)pvExtra;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put the keys of the thread that pvWorker describes, then the shared
+   keys that every thread puts, and check them all. The table expands
+   many times meanwhile. Return NULL. */
+
+static void *putKeys(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   void *pvValue;
+   int iResult;
+   int i;
+
+   for (i = 0; i < OWN_COUNT; i++)
+   {
+      sprintf(acKey, "own%d-%d", psWorker->iNumber, i);
+      ASSURE(SymTable_put(psWorker->oSymTable, acKey, "own"));
+   }
+
+   /* Each thread starts at a different place, so that the threads
+      collide on some keys and not on others. Whichever thread adds a
+      shared key, the others all find its value. */
+   for (i = 0; i < SHARED_COUNT; i++)
+   {
+      sprintf(acKey, "shared%d",
+         (i + psWorker->iNumber * (SHARED_COUNT / THREAD_COUNT))
+         % SHARED_COUNT);
+      iResult = SymTable_getOrPut(psWorker->oSymTable, acKey, "shared",
+         &pvValue);
+      ASSURE(iResult >= 0);
+      ASSURE(strcmp((char*)pvValue, "shared") == 0);
+      if (iResult == 1)
+         psWorker->uSharedAdded++;
+   }
+
+   for (i = 0; i < OWN_COUNT; i++)
+   {
+      sprintf(acKey, "own%d-%d", psWorker->iNumber, i);
+      pcValue = (char*)SymTable_get(psWorker->oSymTable, acKey);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, "own") == 0));
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove all but every KEEP_INTERVALth key of the thread that
+   pvWorker describes and try to remove every shared key, while
+   replacing the keys that are kept and now and then walking the whole
+   table. The table shrinks meanwhile. Return NULL. */
+
+static void *removeKeys(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   size_t uCount;
+   int i;
+
+   for (i = 0; i < OWN_COUNT; i++)
+   {
+      sprintf(acKey, "own%d-%d", psWorker->iNumber, i);
+      if (i % KEEP_INTERVAL != 0)
+      {
+         pcValue = (char*)SymTable_remove(psWorker->oSymTable, acKey);
+         ASSURE((pcValue != NULL) && (strcmp(pcValue, "own") == 0));
+      }
+      else
+      {
+         pcValue = (char*)SymTable_replace(psWorker->oSymTable, acKey,
+            "kept");
+         ASSURE((pcValue != NULL) && (strcmp(pcValue, "own") == 0));
+      }
+
+      /* The keys the thread keeps are never removed, so a walk
+         finds at least those replaced so far. */
+      if (i % MAP_INTERVAL == 0)
+      {
+         uCount = 0;
+         SymTable_map(psWorker->oSymTable, countBinding, &uCount);
+         ASSURE(uCount >= (size_t)(i / KEEP_INTERVAL + 1));
+      }
+   }
+
+   for (i = 0; i < SHARED_COUNT; i++)
+   {
+      sprintf(acKey, "shared%d",
+         (i + psWorker->iNumber * (SHARED_COUNT / THREAD_COUNT))
+         % SHARED_COUNT);
+      if (SymTable_remove(psWorker->oSymTable, acKey) != NULL)
+         psWorker->uSharedRemoved++;
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* CHURN_ROUNDS times, put many keys of the thread that pvWorker
+   describes, look up every key the thread kept, and remove the keys
+   put. The table grows and shrinks meanwhile, and the lookups of each
+   thread overlap the puts and removes of the others. Return NULL. */
+
+static void *churnKeys(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int iRound;
+   int i;
+
+   for (iRound = 0; iRound < CHURN_ROUNDS; iRound++)
+   {
+      for (i = 0; i < CHURN_COUNT; i++)
+      {
+         sprintf(acKey, "churn%d-%d", psWorker->iNumber, i);
+         ASSURE(SymTable_put(psWorker->oSymTable, acKey, "churn"));
+      }
+
+      for (i = 0; i < OWN_COUNT; i += KEEP_INTERVAL)
+      {
+         sprintf(acKey, "own%d-%d", psWorker->iNumber, i);
+         pcValue = (char*)SymTable_get(psWorker->oSymTable, acKey);
+         ASSURE((pcValue != NULL) && (strcmp(pcValue, "kept") == 0));
+         ASSURE(SymTable_contains(psWorker->oSymTable, acKey));
+      }
+
+      for (i = 0; i < CHURN_COUNT; i++)
+      {
+         sprintf(acKey, "churn%d-%d", psWorker->iNumber, i);
+         pcValue = (char*)SymTable_remove(psWorker->oSymTable, acKey);
+         ASSURE((pcValue != NULL) && (strcmp(pcValue, "churn") == 0));
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run pfWork in THREAD_COUNT threads, one for each of asWorkers, and
+   wait for them all to finish. */
+
+static void runThreads(void *(*pfWork)(void *pvWorker),
+   struct Worker asWorkers[])
+{
+   pthread_t aThreads[THREAD_COUNT];
+   int i;
+
+   for (i = 0; i < THREAD_COUNT; i++)
+      ASSURE(pthread_create(&aThreads[i], NULL, pfWork,
+         &asWorkers[i]) == 0);
+   for (i = 0; i < THREAD_COUNT; i++)
+      ASSURE(pthread_join(aThreads[i], NULL) == 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object that several threads use at once. Write the
+   output of the tests to stdout. Return 0. */
+
+int main(void)
+{
+   struct Worker asWorkers[THREAD_COUNT];
+   SymTable_T oSymTable;
+   size_t auCounts[THREAD_COUNT];
+   void *apvCounts[THREAD_COUNT];
+   size_t uAdded = 0;
+   size_t uRemoved = 0;
+   size_t uCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object shared by %d threads.\n",
+      THREAD_COUNT);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < THREAD_COUNT; i++)
+   {
+      asWorkers[i].oSymTable = oSymTable;
+      asWorkers[i].iNumber = i;
+      asWorkers[i].uSharedAdded = 0;
+      asWorkers[i].uSharedRemoved = 0;
+   }
+
+   /* Each shared key is added by exactly one thread. */
+   runThreads(putKeys, asWorkers);
+   for (i = 0; i < THREAD_COUNT; i++)
+      uAdded += asWorkers[i].uSharedAdded;
+   ASSURE(uAdded == SHARED_COUNT);
+   ASSURE(SymTable_getLength(oSymTable)
+      == THREAD_COUNT * OWN_COUNT + SHARED_COUNT);
+
+   /* Each shared key is removed by exactly one thread. */
+   runThreads(removeKeys, asWorkers);
+   for (i = 0; i < THREAD_COUNT; i++)
+      uRemoved += asWorkers[i].uSharedRemoved;
+   ASSURE(uRemoved == SHARED_COUNT);
+   ASSURE(SymTable_getLength(oSymTable)
+      == THREAD_COUNT * OWN_COUNT / KEEP_INTERVAL);
+
+   /* The kept keys are found throughout, however the table changes
+      around them. */
+   runThreads(churnKeys, asWorkers);
+   ASSURE(SymTable_getLength(oSymTable)
+      == THREAD_COUNT * OWN_COUNT / KEEP_INTERVAL);
+
+   /* What is left is the keys each thread kept. */
+   for (i = 0; i < THREAD_COUNT; i++)
+   {
+      auCounts[i] = 0;
+      apvCounts[i] = &auCounts[i];
+   }
+   uCount = 0;
+   SymTable_mapParallel(oSymTable, THREAD_COUNT, countBinding,
+      apvCounts, addCount, &uCount);
+   ASSURE(uCount == THREAD_COUNT * OWN_COUNT / KEEP_INTERVAL);
+
+   SymTable_free(oSymTable);
+
+   printf("------------------------------------------------------\n");
+   printf("End of testsymtablehashmt.\n");
+   return 0;
+}
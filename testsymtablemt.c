@@ -0,0 +1,304 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablemt.c                                                   */
+/* Author: Vikram Kakaria                                             */
+/*--------------------------------------------------------------------*/
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+enum {THREAD_COUNT = 4, OWN_COUNT = 20000, SHARED_COUNT = 20000,
+   RACE_COUNT = 16, RACE_ROUNDS = 50000, MAX_KEY_LENGTH = 32};
+
+/*--------------------------------------------------------------------*/
+
+/* The work of one thread, and what it found. */
+
+struct Worker
+{
+   /* The table all threads share */
+   SymTable_T oSymTable;
+
+   /* The number of this thread, from 0 */
+   int iNumber;
+
+   /* The number of shared keys this thread added */
+   size_t uSharedAdded;
+
+   /* The number of shared keys this thread removed */
+   size_t uSharedRemoved;
+
+   /* The number of race keys this thread added */
+   size_t uRaceAdded;
+
+   /* The number of race keys this thread removed */
+   size_t uRaceRemoved;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. Threads may call it at once, so each
+   message is written by a single call. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put the keys of the thread that pvWorker describes, then the shared
+   keys that every thread puts, and check them all. Return NULL. */
+
+static void *putKeys(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int i;
+
+   for (i = 0; i < OWN_COUNT; i++)
+   {
+      sprintf(acKey, "own%d-%d", psWorker->iNumber, i);
+      ASSURE(SymTable_put(psWorker->oSymTable, acKey, "own"));
+   }
+
+   /* Each thread starts at a different place, so that the threads
+      collide on some keys and not on others. Tables that resize do so
+      many times meanwhile. */
+   for (i = 0; i < SHARED_COUNT; i++)
+   {
+      sprintf(acKey, "shared%d",
+         (i + psWorker->iNumber * (SHARED_COUNT / THREAD_COUNT))
+         % SHARED_COUNT);
+      if (SymTable_put(psWorker->oSymTable, acKey, "shared"))
+         psWorker->uSharedAdded++;
+   }
+
+   for (i = 0; i < OWN_COUNT; i++)
+   {
+      sprintf(acKey, "own%d-%d", psWorker->iNumber, i);
+      pcValue = (char*)SymTable_get(psWorker->oSymTable, acKey);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, "own") == 0));
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the odd keys of the thread that pvWorker describes and try
+   to remove every shared key, while replacing the even keys. Return
+   NULL. */
+
+static void *removeKeys(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int i;
+
+   for (i = 0; i < OWN_COUNT; i++)
+   {
+      sprintf(acKey, "own%d-%d", psWorker->iNumber, i);
+      if (i % 2 == 1)
+      {
+         pcValue = (char*)SymTable_remove(psWorker->oSymTable, acKey);
+         ASSURE((pcValue != NULL) && (strcmp(pcValue, "own") == 0));
+      }
+      else
+      {
+         pcValue = (char*)SymTable_replace(psWorker->oSymTable, acKey,
+            "kept");
+         ASSURE((pcValue != NULL) && (strcmp(pcValue, "own") == 0));
+      }
+   }
+
+   for (i = 0; i < SHARED_COUNT; i++)
+   {
+      sprintf(acKey, "shared%d",
+         (i + psWorker->iNumber * (SHARED_COUNT / THREAD_COUNT))
+         % SHARED_COUNT);
+      if (SymTable_remove(psWorker->oSymTable, acKey) != NULL)
+         psWorker->uSharedRemoved++;
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put, get and remove the few race keys over and over, as every other
+   thread does at the same time, so that a put of a key often overlaps
+   a remove of the same key. Return NULL. */
+
+static void *raceKeys(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int i;
+
+   for (i = 0; i < RACE_ROUNDS; i++)
+   {
+      sprintf(acKey, "race%d", (i + psWorker->iNumber) % RACE_COUNT);
+      if (SymTable_put(psWorker->oSymTable, acKey, "race"))
+         psWorker->uRaceAdded++;
+      pcValue = (char*)SymTable_get(psWorker->oSymTable, acKey);
+      ASSURE((pcValue == NULL) || (strcmp(pcValue, "race") == 0));
+      pcValue = (char*)SymTable_remove(psWorker->oSymTable, acKey);
+      if (pcValue != NULL)
+      {
+         ASSURE(strcmp(pcValue, "race") == 0);
+         psWorker->uRaceRemoved++;
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run pfWork in THREAD_COUNT threads, one for each of asWorkers, and
+   wait for them all to finish. */
+
+static void runThreads(void *(*pfWork)(void *pvWorker),
+   struct Worker asWorkers[])
+{
+   pthread_t aThreads[THREAD_COUNT];
+   int i;
+
+   for (i = 0; i < THREAD_COUNT; i++)
+      ASSURE(pthread_create(&aThreads[i], NULL, pfWork,
+         &asWorkers[i]) == 0);
+   for (i = 0; i < THREAD_COUNT; i++)
+      ASSURE(pthread_join(aThreads[i], NULL) == 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The state of a walk over bindings. */
+
+struct Walk
+{
+   /* The key visited last, or NULL if none has been */
+   const char *pcPrevious;
+
+   /* The number of bindings visited */
+   size_t uCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Record the visit of the binding whose key is pcKey in the Walk
+   pointed to by pvExtra, checking that its value is "kept" and, if
+   CHECK_ORDER is defined, that keys arrive in increasing order. */
+
+static void visitBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct Walk *psWalk = (struct Walk*)pvExtra;
+
+   ASSURE(strcmp((char*)pvValue, "kept") == 0);
+#ifdef CHECK_ORDER
+   ASSURE((psWalk->pcPrevious == NULL)
+      || (strcmp(psWalk->pcPrevious, pcKey) < 0));
+#endif
+   psWalk->pcPrevious = pcKey;
+   psWalk->uCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object that several threads use at once, of any
+   thread-safe implementation of symtable.h. Define CHECK_ORDER for
+   implementations whose SymTable_map visits keys in increasing order.
+   Write the output of the tests to stdout. Return 0. */
+
+int main(void)
+{
+   struct Worker asWorkers[THREAD_COUNT];
+   SymTable_T oSymTable;
+   size_t uAdded = 0;
+   size_t uRemoved = 0;
+   struct Walk sWalk;
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object shared by %d threads.\n",
+      THREAD_COUNT);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < THREAD_COUNT; i++)
+   {
+      asWorkers[i].oSymTable = oSymTable;
+      asWorkers[i].iNumber = i;
+      asWorkers[i].uSharedAdded = 0;
+      asWorkers[i].uSharedRemoved = 0;
+      asWorkers[i].uRaceAdded = 0;
+      asWorkers[i].uRaceRemoved = 0;
+   }
+
+   /* Each shared key is added by exactly one thread. */
+   runThreads(putKeys, asWorkers);
+   for (i = 0; i < THREAD_COUNT; i++)
+      uAdded += asWorkers[i].uSharedAdded;
+   ASSURE(uAdded == SHARED_COUNT);
+   ASSURE(SymTable_getLength(oSymTable)
+      == THREAD_COUNT * OWN_COUNT + SHARED_COUNT);
+
+   /* Each shared key is removed by exactly one thread. */
+   runThreads(removeKeys, asWorkers);
+   for (i = 0; i < THREAD_COUNT; i++)
+      uRemoved += asWorkers[i].uSharedRemoved;
+   ASSURE(uRemoved == SHARED_COUNT);
+   ASSURE(SymTable_getLength(oSymTable)
+      == THREAD_COUNT * OWN_COUNT / 2);
+
+   /* Each race key that was added was removed once, by a thread or
+      here. */
+   runThreads(raceKeys, asWorkers);
+   uAdded = 0;
+   uRemoved = 0;
+   for (i = 0; i < THREAD_COUNT; i++)
+   {
+      uAdded += asWorkers[i].uRaceAdded;
+      uRemoved += asWorkers[i].uRaceRemoved;
+   }
+   for (i = 0; i < RACE_COUNT; i++)
+   {
+      sprintf(acKey, "race%d", i);
+      if (SymTable_remove(oSymTable, acKey) != NULL)
+         uRemoved++;
+   }
+   ASSURE(uAdded == uRemoved);
+   ASSURE(SymTable_getLength(oSymTable)
+      == THREAD_COUNT * OWN_COUNT / 2);
+
+   /* What is left is the even keys of each thread. */
+   sWalk.pcPrevious = NULL;
+   sWalk.uCount = 0;
+   SymTable_map(oSymTable, visitBinding, &sWalk);
+   ASSURE(sWalk.uCount == THREAD_COUNT * OWN_COUNT / 2);
+
+   SymTable_free(oSymTable);
+
+   printf("------------------------------------------------------\n");
+   printf("End of testsymtablemt.\n");
+   return 0;
+}
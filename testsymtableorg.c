@@ -0,0 +1,117 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableorg.c                                                  */
+/* Author: Vikram Kakaria                                             */
+/*--------------------------------------------------------------------*/
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* The order of bindings that SymTable_map is expected to visit after
+   each lookup, one character per key. Keys are put at the head of
+   their chain, so "dcba" is the order after putting "a" to "d". */
+
+#if defined(SYMTABLE_MOVE_TO_FRONT)
+static const char *apcExpected[] = {"dcba", "adcb", "badc", "badc"};
+#elif defined(SYMTABLE_TRANSPOSE)
+static const char *apcExpected[] = {"dcba", "dcab", "dcba", "dbca"};
+#else
+#error "Define SYMTABLE_MOVE_TO_FRONT or SYMTABLE_TRANSPOSE"
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Append the first character of pcKey to the string pointed to by
+   pvExtra. pvValue is unused. */
+
+static void appendKey(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   char *pcOrder = (char*)pvExtra;
+   size_t uLength;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   (void)pvValue;
+   uLength = strlen(pcOrder);
+   pcOrder[uLength] = pcKey[0];
+   pcOrder[uLength + 1] = '\0';
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (for true) if SymTable_map visits the bindings of
+   oSymTable in the order pcExpected gives, or 0 (for false)
+   otherwise. */
+
+static int hasOrder(SymTable_T oSymTable, const char *pcExpected)
+{
+   char acOrder[8];
+
+   acOrder[0] = '\0';
+   SymTable_map(oSymTable, appendKey, acOrder);
+   return strcmp(acOrder, pcExpected) == 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that lookups reorder a SymTable object as the self-organizing
+   mode it was built with requires: a key at the tail is found, then
+   the key that is at the tail after that, and then that key again.
+   Write the output of the tests to stdout. Return 0. */
+
+int main(void)
+{
+   SymTable_T oSymTable;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the self-organizing order of a SymTable object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_put(oSymTable, "a", "1"));
+   ASSURE(SymTable_put(oSymTable, "b", "2"));
+   ASSURE(SymTable_put(oSymTable, "c", "3"));
+   ASSURE(SymTable_put(oSymTable, "d", "4"));
+   ASSURE(hasOrder(oSymTable, apcExpected[0]));
+
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "a"), "1") == 0);
+   ASSURE(hasOrder(oSymTable, apcExpected[1]));
+
+   ASSURE(SymTable_contains(oSymTable, "b"));
+   ASSURE(hasOrder(oSymTable, apcExpected[2]));
+
+   ASSURE(strcmp((char*)SymTable_replace(oSymTable, "b", "5"), "2")
+      == 0);
+   ASSURE(hasOrder(oSymTable, apcExpected[3]));
+
+   SymTable_free(oSymTable);
+
+   printf("------------------------------------------------------\n");
+   printf("End of testsymtableorg.\n");
+   return 0;
+}